@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../iovm.h"
+
+// access check cost per instruction for programs of hundreds of READs: ACL page bitmaps against scanning a list of
+// permitted ranges, and iovm1_verify() with and without an ACL registered
+
+#define WRAM_SIZE 0x20000UL
+#define RANGES 32
+#define ROUNDS 2000
+
+struct range_t {
+    uint32_t a;
+    uint32_t l;
+};
+
+static uint64_t wram_r[IOVM1_ACL_WORDS(WRAM_SIZE)];
+static struct iovm1_acl_chip_t acl[] = {
+    [MEM_SNES_WRAM] = { wram_r, 0, IOVM1_ACL_PAGES(WRAM_SIZE) },
+};
+static struct range_t ranges[RANGES];
+static volatile uint32_t sink;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// host functions; the benchmark never executes programs:
+enum iovm1_error host_memory_read_state_machine(struct iovm1_t *vm) { return IOVM1_SUCCESS; }
+enum iovm1_error host_memory_write_state_machine(struct iovm1_t *vm) { return IOVM1_SUCCESS; }
+enum iovm1_error host_memory_wait_state_machine(struct iovm1_t *vm) { return IOVM1_SUCCESS; }
+enum iovm1_error host_memory_verify_state_machine(struct iovm1_t *vm) { return IOVM1_SUCCESS; }
+enum iovm1_error host_memory_search_state_machine(struct iovm1_t *vm) { return IOVM1_SUCCESS; }
+enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t *b) {
+    return IOVM1_SUCCESS;
+}
+enum iovm1_error host_memory_try_write_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t b) {
+    return IOVM1_SUCCESS;
+}
+void host_send_end(struct iovm1_t *vm) {}
+
+static int range_permits(uint32_t a, uint32_t l) {
+    for (uint32_t i = 0; i < RANGES; i++) {
+        if (a >= ranges[i].a && a + l <= ranges[i].a + ranges[i].l) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// builds `n` READs of 1..256 bytes, each lying within one permitted range:
+static void build_program(uint8_t *m, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        const struct range_t *r = &ranges[rand() % RANGES];
+        uint32_t l = 1 + rand() % (r->l < 256 ? r->l : 256);
+        uint32_t a = r->a + rand() % (r->l - l + 1);
+
+        m[i * 6 + 0] = IOVM1_OPCODE_READ;
+        m[i * 6 + 1] = MEM_SNES_WRAM;
+        m[i * 6 + 2] = a & 0xFF;
+        m[i * 6 + 3] = (a >> 8) & 0xFF;
+        m[i * 6 + 4] = (a >> 16) & 0xFF;
+        m[i * 6 + 5] = l & 0xFF;
+    }
+}
+
+static uint32_t decode_len(const uint8_t *m) {
+    return m[5] ? m[5] : 256;
+}
+
+static uint32_t decode_addr(const uint8_t *m) {
+    return (uint32_t)m[2] | ((uint32_t)m[3] << 8) | ((uint32_t)m[4] << 16);
+}
+
+static void run(uint32_t n) {
+    static uint8_t m[6 * 1000];
+    struct iovm1_t vm;
+    uint64_t t0, t_list, t_bits, t_none, t_acl;
+    uint32_t ok = 0;
+
+    build_program(m, n);
+
+    t0 = now_ns();
+    for (uint32_t k = 0; k < ROUNDS; k++) {
+        for (uint32_t i = 0; i < n; i++) {
+            ok += range_permits(decode_addr(m + i * 6), decode_len(m + i * 6));
+        }
+    }
+    t_list = now_ns() - t0;
+
+    t0 = now_ns();
+    for (uint32_t k = 0; k < ROUNDS; k++) {
+        for (uint32_t i = 0; i < n; i++) {
+            ok += iovm1_acl_test(wram_r, acl[MEM_SNES_WRAM].pages, decode_addr(m + i * 6), decode_len(m + i * 6));
+        }
+    }
+    t_bits = now_ns() - t0;
+
+    iovm1_init(&vm);
+    iovm1_load(&vm, m, n * 6);
+    t0 = now_ns();
+    for (uint32_t k = 0; k < ROUNDS; k++) {
+        ok += iovm1_verify(&vm) == IOVM1_SUCCESS;
+    }
+    t_none = now_ns() - t0;
+
+    iovm1_set_acl(&vm, acl, MEM_SNES_WRAM + 1);
+    t0 = now_ns();
+    for (uint32_t k = 0; k < ROUNDS; k++) {
+        ok += iovm1_verify(&vm) == IOVM1_SUCCESS;
+    }
+    t_acl = now_ns() - t0;
+
+    if (ok != ROUNDS * (2 * n + 2)) {
+        fprintf(stderr, "acl: %u of %u checks passed\n", ok, ROUNDS * (2 * n + 2));
+        exit(1);
+    }
+    sink += ok;
+
+    printf(
+        "%-6u %12.2f %12.2f %12.2f %12.2f\n",
+        n,
+        (double)t_list / ((double)ROUNDS * n),
+        (double)t_bits / ((double)ROUNDS * n),
+        (double)t_none / ((double)ROUNDS * n),
+        (double)t_acl / ((double)ROUNDS * n)
+    );
+}
+
+int main(int argc, char **argv) {
+    uint32_t sizes[] = { 100, 300, 1000 };
+
+    srand(1);
+
+    // scattered permitted ranges of 16 bytes to 2 KiB:
+    for (uint32_t i = 0; i < RANGES; i++) {
+        ranges[i].l = 16UL << (rand() % 8);
+        ranges[i].a = (uint32_t)(rand() % (WRAM_SIZE - ranges[i].l));
+    }
+    // the bitmap grants the pages overlapping each range, so it may permit more than the list:
+    for (uint32_t i = 0; i < RANGES; i++) {
+        iovm1_acl_grant(wram_r, acl[MEM_SNES_WRAM].pages, ranges[i].a, ranges[i].l);
+    }
+
+    printf("access check cost, ns per instruction (%u permitted ranges)\n", RANGES);
+    printf("%-6s %12s %12s %12s %12s\n", "insns", "range list", "bitmap", "verify", "verify+acl");
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        run(sizes[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,411 @@
+#ifndef IOVM_BENCH_H
+#define IOVM_BENCH_H
+
+/*
+    bench.h: minimal benchmark harness
+
+    each case is measured in `runs` independent runs. a run executes `warmup` untimed repetitions then `reps`
+    individually timed repetitions and takes their median. results report the minimum repetition time, the median
+    and 99th percentile across runs, the mean and standard deviation of the run medians as a noise estimate, and
+    the median time per VM instruction. results are printed as a table and optionally emitted as JSON for comparing
+    commits:
+
+        {"suite":"iovm","results":[{"name":"...","reps":N,"runs":N,"insts":N,"min_ns":N,"median_ns":N,"p99_ns":N,
+         "mean_ns":N,"stddev_ns":N,"ns_per_inst":N[,"cycles":N,"instructions":N,"branch_misses":N,
+         "l1d_misses":N]},...]}
+
+    with bench_perf_open(), each run also reads hardware counters through perf_event_open(2) around its timed
+    repetitions: cycles, instructions, branch misses and L1d read misses, scaled for multiplexing. counters the
+    kernel or hardware refuses (containers, VMs, perf_event_paranoid) are reported as unavailable and the
+    benchmark continues on wall time alone.
+
+    a previous JSON file can be loaded as a baseline. bench_compare() then reports per case deltas with a 95%
+    confidence interval from Welch's t-test over the run medians, and flags a regression when the whole interval
+    lies above the allowed threshold.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define BENCH_MAX_RUNS 64
+
+enum bench_counter {
+    BENCH_CYCLES,
+    BENCH_INSTRUCTIONS,
+    BENCH_BRANCH_MISSES,
+    BENCH_L1D_MISSES,
+    BENCH_COUNTERS
+};
+
+// perf_event_open file descriptors, -1 when unavailable:
+static int bench_perf_fd[BENCH_COUNTERS] = { -1, -1, -1, -1 };
+
+struct bench_result {
+    char name[32];
+    int reps;
+    int runs;
+    // VM instructions executed per repetition:
+    uint64_t insts;
+    double min_ns;
+    double median_ns;
+    double p99_ns;
+    // mean and sample standard deviation of the per run medians:
+    double mean_ns;
+    double stddev_ns;
+    double ns_per_inst;
+    // hardware counters per repetition, summed over all runs then divided; negative when unavailable:
+    double counters[BENCH_COUNTERS];
+};
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int bench_cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+#ifdef __linux__
+static int bench_perf_event(uint32_t type, uint64_t config) {
+    struct perf_event_attr a;
+
+    memset(&a, 0, sizeof(a));
+    a.size = sizeof(a);
+    a.type = type;
+    a.config = config;
+    a.disabled = 1;
+    a.exclude_kernel = 1;
+    a.exclude_hv = 1;
+    a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+}
+#endif
+
+// opens the hardware counters for this thread; returns the number available
+static int bench_perf_open(void) {
+    int n = 0;
+#ifdef __linux__
+    bench_perf_fd[BENCH_CYCLES] = bench_perf_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    bench_perf_fd[BENCH_INSTRUCTIONS] = bench_perf_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    bench_perf_fd[BENCH_BRANCH_MISSES] = bench_perf_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    bench_perf_fd[BENCH_L1D_MISSES] = bench_perf_event(
+        PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    );
+    for (int i = 0; i < BENCH_COUNTERS; i++) {
+        n += bench_perf_fd[i] >= 0;
+    }
+#endif
+    return n;
+}
+
+static void bench_perf_start(void) {
+#ifdef __linux__
+    for (int i = 0; i < BENCH_COUNTERS; i++) {
+        if (bench_perf_fd[i] >= 0) {
+            ioctl(bench_perf_fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(bench_perf_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+// stops the counters and adds their scaled values to `sum`; unavailable counters add nothing:
+static void bench_perf_stop(double sum[BENCH_COUNTERS]) {
+#ifdef __linux__
+    for (int i = 0; i < BENCH_COUNTERS; i++) {
+        uint64_t v[3];
+
+        if (bench_perf_fd[i] < 0) {
+            continue;
+        }
+        ioctl(bench_perf_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(bench_perf_fd[i], v, sizeof(v)) != sizeof(v) || v[2] == 0) {
+            continue;
+        }
+        // value * time enabled / time running, in case the counter was multiplexed:
+        sum[i] += (double)v[0] * ((double)v[1] / (double)v[2]);
+    }
+#else
+    (void) sum;
+#endif
+}
+
+static void bench_run(
+    struct bench_result *r,
+    const char *name,
+    void (*fn)(void *arg),
+    void *arg,
+    uint64_t insts,
+    int warmup,
+    int reps,
+    int runs
+) {
+    uint64_t *t = malloc(sizeof(uint64_t) * (size_t)reps);
+    double medians[BENCH_MAX_RUNS];
+    double p99s[BENCH_MAX_RUNS];
+    double counters[BENCH_COUNTERS] = { 0 };
+    double sum = 0, ss = 0;
+
+    if (runs > BENCH_MAX_RUNS) {
+        runs = BENCH_MAX_RUNS;
+    }
+
+    memset(r, 0, sizeof(*r));
+    strncpy(r->name, name, sizeof(r->name) - 1);
+    r->reps = reps;
+    r->runs = runs;
+    r->insts = insts;
+
+    for (int k = 0; k < runs; k++) {
+        for (int i = 0; i < warmup; i++) {
+            fn(arg);
+        }
+        bench_perf_start();
+        for (int i = 0; i < reps; i++) {
+            uint64_t t0 = bench_now_ns();
+            fn(arg);
+            t[i] = bench_now_ns() - t0;
+        }
+        bench_perf_stop(counters);
+        qsort(t, (size_t)reps, sizeof(uint64_t), bench_cmp_u64);
+
+        if (k == 0 || (double)t[0] < r->min_ns) {
+            r->min_ns = (double)t[0];
+        }
+        medians[k] = (double)t[reps / 2];
+        p99s[k] = (double)t[(reps * 99) / 100 < reps ? (reps * 99) / 100 : reps - 1];
+        sum += medians[k];
+    }
+
+    r->mean_ns = sum / runs;
+    for (int k = 0; k < runs; k++) {
+        ss += (medians[k] - r->mean_ns) * (medians[k] - r->mean_ns);
+    }
+    r->stddev_ns = runs > 1 ? sqrt(ss / (runs - 1)) : 0;
+
+    qsort(medians, (size_t)runs, sizeof(double), bench_cmp_double);
+    qsort(p99s, (size_t)runs, sizeof(double), bench_cmp_double);
+    r->median_ns = medians[runs / 2];
+    r->p99_ns = p99s[runs / 2];
+    r->ns_per_inst = insts ? r->median_ns / (double)insts : 0;
+    for (int i = 0; i < BENCH_COUNTERS; i++) {
+        r->counters[i] = bench_perf_fd[i] >= 0 ? counters[i] / ((double)reps * runs) : -1;
+    }
+
+    free(t);
+}
+
+static void bench_print_header(FILE *f) {
+    fprintf(f, "%-20s %6s %5s %8s %12s %12s %12s %10s %10s\n",
+        "case", "reps", "runs", "insts", "min ns", "median ns", "p99 ns", "stddev", "ns/inst");
+}
+
+static void bench_print(FILE *f, const struct bench_result *r) {
+    fprintf(f, "%-20s %6d %5d %8llu %12.0f %12.0f %12.0f %10.1f %10.2f\n",
+        r->name, r->reps, r->runs, (unsigned long long)r->insts,
+        r->min_ns, r->median_ns, r->p99_ns, r->stddev_ns, r->ns_per_inst);
+}
+
+// IPC and per VM instruction hardware counter ratios; "-" for unavailable counters
+static void bench_print_perf_header(FILE *f) {
+    fprintf(f, "%-20s %10s %8s %14s %14s %14s\n",
+        "case", "cyc/inst", "IPC", "insn/inst", "br-miss/inst", "L1d-miss/inst");
+}
+
+static void bench_print_perf_value(FILE *f, int width, double v, double d) {
+    if (v < 0 || d <= 0) {
+        fprintf(f, " %*s", width, "-");
+    } else {
+        fprintf(f, " %*.3f", width, v / d);
+    }
+}
+
+static void bench_print_perf(FILE *f, const struct bench_result *r) {
+    double n = (double)r->insts;
+
+    fprintf(f, "%-20s", r->name);
+    bench_print_perf_value(f, 10, r->counters[BENCH_CYCLES], n);
+    bench_print_perf_value(f, 8, r->counters[BENCH_CYCLES] < 0 ? -1 : r->counters[BENCH_INSTRUCTIONS],
+        r->counters[BENCH_CYCLES]);
+    bench_print_perf_value(f, 14, r->counters[BENCH_INSTRUCTIONS], n);
+    bench_print_perf_value(f, 14, r->counters[BENCH_BRANCH_MISSES], n);
+    bench_print_perf_value(f, 14, r->counters[BENCH_L1D_MISSES], n);
+    fprintf(f, "\n");
+}
+
+static void bench_json(FILE *f, const struct bench_result *rs, int n) {
+    static const char *names[BENCH_COUNTERS] = { "cycles", "instructions", "branch_misses", "l1d_misses" };
+
+    fprintf(f, "{\"suite\":\"iovm\",\"results\":[");
+    for (int i = 0; i < n; i++) {
+        const struct bench_result *r = &rs[i];
+        fprintf(f, "%s\n{\"name\":\"%s\",\"reps\":%d,\"runs\":%d,\"insts\":%llu,\"min_ns\":%.0f,\"median_ns\":%.0f,"
+                   "\"p99_ns\":%.0f,\"mean_ns\":%.1f,\"stddev_ns\":%.1f,\"ns_per_inst\":%.3f",
+            i ? "," : "",
+            r->name, r->reps, r->runs, (unsigned long long)r->insts,
+            r->min_ns, r->median_ns, r->p99_ns, r->mean_ns, r->stddev_ns, r->ns_per_inst);
+        // hardware counters per repetition, only when available:
+        for (int k = 0; k < BENCH_COUNTERS; k++) {
+            if (r->counters[k] >= 0) {
+                fprintf(f, ",\"%s\":%.1f", names[k], r->counters[k]);
+            }
+        }
+        fprintf(f, "}");
+    }
+    fprintf(f, "\n]}\n");
+}
+
+// reads `"key":<number>` from within one JSON object; leaves `v` untouched when absent:
+static void bench_json_number(const char *obj, const char *end, const char *key, double *v) {
+    char pat[40];
+    const char *q;
+
+    snprintf(pat, sizeof(pat), "\"%s\":", key);
+    q = strstr(obj, pat);
+    if (q && q < end) {
+        *v = strtod(q + strlen(pat), 0);
+    }
+}
+
+// loads results written by bench_json(); returns the number loaded or -1 on error
+static int bench_json_load(const char *path, struct bench_result *rs, int max) {
+    FILE *f = fopen(path, "r");
+    char *text;
+    long l;
+    int n = 0;
+
+    if (!f) {
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    l = ftell(f);
+    rewind(f);
+    text = malloc((size_t)l + 1);
+    if (!text || fread(text, 1, (size_t)l, f) != (size_t)l) {
+        free(text);
+        fclose(f);
+        return -1;
+    }
+    text[l] = 0;
+    fclose(f);
+
+    for (const char *q = strstr(text, "{\"name\":\""); q && n < max; q = strstr(q + 1, "{\"name\":\"")) {
+        struct bench_result *r = &rs[n++];
+        const char *end = strchr(q, '}');
+        const char *name = q + 9;
+        size_t nl = strcspn(name, "\"");
+        double v;
+
+        if (!end) {
+            break;
+        }
+        memset(r, 0, sizeof(*r));
+        memcpy(r->name, name, nl < sizeof(r->name) - 1 ? nl : sizeof(r->name) - 1);
+
+        v = 1;
+        bench_json_number(q, end, "runs", &v);
+        r->runs = (int)v;
+        bench_json_number(q, end, "median_ns", &r->median_ns);
+        r->mean_ns = r->median_ns;
+        bench_json_number(q, end, "mean_ns", &r->mean_ns);
+        bench_json_number(q, end, "stddev_ns", &r->stddev_ns);
+    }
+
+    free(text);
+    return n;
+}
+
+// two-sided 95% critical value of Student's t distribution:
+static double bench_t95(double dof) {
+    static const double t[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    int d = (int)dof;
+
+    if (d < 1) {
+        return t[1];
+    }
+    return d <= 30 ? t[d] : 1.96;
+}
+
+// compares `rs` against `base` by case name; returns the number of significant regressions beyond `threshold`
+// (a fraction, e.g. 0.05 for 5%)
+static int bench_compare(FILE *f, const struct bench_result *rs, int n, const struct bench_result *base, int nb,
+                         double threshold) {
+    int regressions = 0;
+
+    fprintf(f, "%-20s %12s %12s %9s %18s  %s\n", "case", "base ns", "new ns", "delta", "95% CI", "verdict");
+    for (int i = 0; i < n; i++) {
+        const struct bench_result *r = &rs[i];
+        const struct bench_result *b = 0;
+        double va, vb, se, dof, d, lo, hi;
+        const char *verdict;
+
+        for (int j = 0; j < nb; j++) {
+            if (strcmp(base[j].name, r->name) == 0) {
+                b = &base[j];
+                break;
+            }
+        }
+        if (!b || b->mean_ns <= 0) {
+            fprintf(f, "%-20s %12s %12.0f %9s %18s  %s\n", r->name, "-", r->mean_ns, "-", "-", "new");
+            continue;
+        }
+
+        // Welch's t-test on the run medians:
+        va = r->runs > 0 ? r->stddev_ns * r->stddev_ns / r->runs : 0;
+        vb = b->runs > 0 ? b->stddev_ns * b->stddev_ns / b->runs : 0;
+        se = sqrt(va + vb);
+        dof = 1;
+        if (va + vb > 0 && r->runs > 1 && b->runs > 1) {
+            dof = (va + vb) * (va + vb) / (va * va / (r->runs - 1) + vb * vb / (b->runs - 1));
+        }
+
+        d = r->mean_ns - b->mean_ns;
+        lo = (d - bench_t95(dof) * se) / b->mean_ns;
+        hi = (d + bench_t95(dof) * se) / b->mean_ns;
+
+        if (lo > threshold) {
+            verdict = "REGRESSED";
+            regressions++;
+        } else if (hi < -threshold) {
+            verdict = "improved";
+        } else if (lo > 0 || hi < 0) {
+            verdict = "changed within threshold";
+        } else {
+            verdict = "no significant change";
+        }
+
+        fprintf(f, "%-20s %12.0f %12.0f %+8.1f%% [%+6.1f%%, %+6.1f%%]  %s\n",
+            r->name, b->mean_ns, r->mean_ns, 100 * d / b->mean_ns, 100 * lo, 100 * hi, verdict);
+    }
+
+    return regressions;
+}
+
+#endif //IOVM_BENCH_H
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../iovm.h"
+#ifdef BENCH_HOOKS_PROF
+#include "../iovm_prof.h"
+#endif
+#ifdef BENCH_HOOKS_TRACE
+#include "../iovm_trace.h"
+#endif
+#ifdef BENCH_HOOKS_HIST
+#include "../iovm_hist.h"
+#endif
+
+// iovm1_exec() dispatch cost with hooks compiled out, compiled in as no-ops, compiled in with iovm_prof,
+// compiled in with iovm_trace drained by its consumer thread, and compiled in with iovm_hist
+
+#define WRAM_SIZE (128UL << 10)
+
+static uint8_t wram[WRAM_SIZE];
+
+#ifdef BENCH_HOOKS_PROF
+static struct iovm1_prof_t prof;
+#endif
+#ifdef BENCH_HOOKS_TRACE
+static struct iovm1_trace_rec_t ring[1 << 16];
+static struct iovm1_trace_t trace;
+static struct iovm1_trace_writer_t writer;
+#endif
+#ifdef BENCH_HOOKS_HIST
+static struct iovm1_hists_t hists;
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// minimal host serving WRAM only:
+///////////////////////////////////////////////////////////////////////////////////////////
+
+enum iovm1_error host_memory_read_state_machine(struct iovm1_t *vm) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+enum iovm1_error host_memory_write_state_machine(struct iovm1_t *vm) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+enum iovm1_error host_memory_wait_state_machine(struct iovm1_t *vm) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+enum iovm1_error host_memory_verify_state_machine(struct iovm1_t *vm) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+enum iovm1_error host_memory_search_state_machine(struct iovm1_t *vm) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t *b) {
+    if (c != MEM_SNES_WRAM) {
+        return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+    }
+    *b = wram[a & (WRAM_SIZE - 1)];
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error host_memory_try_write_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t b) {
+    if (c != MEM_SNES_WRAM) {
+        return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+    }
+    wram[a & (WRAM_SIZE - 1)] = b;
+    return IOVM1_SUCCESS;
+}
+
+void host_send_end(struct iovm1_t *vm) {}
+
+#ifdef IOVM1_USE_HOOKS
+void host_hook(struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg) {
+#ifdef BENCH_HOOKS_PROF
+    iovm1_prof_hook(&prof, vm, h, arg);
+#endif
+#ifdef BENCH_HOOKS_TRACE
+    iovm1_trace_hook(&trace, 0, vm, h, arg);
+#endif
+#ifdef BENCH_HOOKS_HIST
+    iovm1_hists_hook(&hists, vm, h, arg);
+#endif
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// benchmark:
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    (void) argc;
+    (void) argv;
+
+    const int insts = 96;
+    const int reps = 100000;
+    uint8_t proc[96 * 9];
+    uint8_t *p = proc;
+    struct iovm1_t vm;
+    double t;
+
+    // ABORT_UNLESS, RMW and SKIP_UNLESS(skip 0) cycling over WRAM:
+    for (int i = 0; i < insts; i++) {
+        switch (i % 3) {
+            case 0: *p++ = IOVM1_MK_ABORT_UNLESS(IOVM1_CMP_NGT); break;
+            case 1: *p++ = IOVM1_MK_RMW(IOVM1_ALU_ADD); break;
+            case 2: *p++ = IOVM1_MK_SKIP_UNLESS(IOVM1_CMP_EQ); break;
+        }
+        *p++ = MEM_SNES_WRAM;
+        *p++ = (uint8_t)(i * 2);
+        *p++ = 0x10;
+        *p++ = 0x7E;
+        *p++ = i % 3 == 0 ? 0xFF : 0x01;
+        *p++ = i % 3 == 0 ? 0xFF : 0x00;
+        if (i % 3 == 2) {
+            *p++ = 0x00;
+            *p++ = 0x00;
+        }
+    }
+
+#ifdef BENCH_HOOKS_PROF
+    iovm1_prof_init(&prof);
+#endif
+#ifdef BENCH_HOOKS_HIST
+    iovm1_hists_init(&hists);
+#endif
+#ifdef BENCH_HOOKS_TRACE
+    iovm1_trace_init(&trace, ring, sizeof(ring) / sizeof(ring[0]));
+    // optionally keep the trace for `iovm_tracedump -c` to convert into a Chrome trace:
+    if (iovm1_trace_writer_start(&writer, &trace, fopen(argc > 1 ? argv[1] : "/dev/null", "wb")) != 0) {
+        fprintf(stdout, "could not start trace writer\n");
+        return 1;
+    }
+#endif
+
+    iovm1_init(&vm);
+    iovm1_load(&vm, proc, (unsigned)(p - proc));
+    if (iovm1_verify(&vm) != IOVM1_SUCCESS) {
+        fprintf(stdout, "program failed verification at %u\n", vm.p);
+        return 1;
+    }
+
+    t = now();
+    for (int r = 0; r < reps; r++) {
+        iovm1_exec_reset(&vm);
+        do {
+            iovm1_exec(&vm);
+        } while (iovm1_get_exec_state(&vm) < IOVM1_STATE_ENDED);
+    }
+    t = now() - t;
+
+#ifdef BENCH_HOOKS_TRACE
+    iovm1_trace_writer_stop(&writer);
+#endif
+
+    if (iovm1_get_exec_state(&vm) != IOVM1_STATE_ENDED) {
+        fprintf(stdout, "unexpected state %d\n", iovm1_get_exec_state(&vm));
+        return 1;
+    }
+
+#if defined(BENCH_HOOKS_PROF)
+    const char *name = "hooks with iovm_prof";
+#elif defined(BENCH_HOOKS_TRACE)
+    const char *name = "hooks with iovm_trace";
+#elif defined(BENCH_HOOKS_HIST)
+    const char *name = "hooks with iovm_hist";
+#elif defined(IOVM1_USE_HOOKS)
+    const char *name = "hooks no-op";
+#else
+    const char *name = "hooks compiled out";
+#endif
+    fprintf(stdout, "%-24s %9.2f ns/inst\n", name, t * 1e9 / ((double)reps * insts));
+#ifdef BENCH_HOOKS_TRACE
+    fprintf(stdout, "%-24s %9.2f %% records dropped\n", "",
+        100.0 * (double)trace.dropped / (double)(trace.head + trace.dropped));
+#endif
+
+#ifdef BENCH_HOOKS_PROF
+    if (argc > 1) {
+        iovm1_prof_dump(&prof, stdout);
+    }
+#endif
+#ifdef BENCH_HOOKS_HIST
+    if (argc > 1) {
+        iovm1_hists_dump(&hists, stdout);
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../iovm.h"
+#include "../iovm_host.h"
+
+// ROM READ cost with the reference host's per-bank tables, resolved once per READ, against translating every byte
+// of the READ with branches on bank and offset
+
+#define ROM_SIZE (4UL << 20)
+#define ACCESSES 4096
+
+static struct iovm1_host_t host;
+static uint24_t addrs[ACCESSES];
+static uint8_t buf[256];
+static volatile uint32_t sink;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void on_reply(void *ctx, struct iovm1_t *vm, enum iovm1_host_reply r, const uint8_t *d, uint32_t l) {
+    sink += d[0] + d[l - 1];
+}
+
+// bus address to ROM offset the way a host without tables does it; -1 when unmapped:
+static int32_t branchy_translate(enum iovm1_host_mapping m, uint24_t a) {
+    uint32_t bank = (a >> 16) & 0xFF;
+    uint32_t off = a & 0xFFFF;
+
+    if (bank == 0x7E || bank == 0x7F) {
+        return -1;
+    }
+    if (m == IOVM1_HOST_MAPPING_LOROM) {
+        if (off < 0x8000) {
+            return -1;
+        }
+        return (int32_t)((((bank & 0x7F) << 15) | (off - 0x8000)) % ROM_SIZE);
+    }
+    if ((bank & 0x40) == 0 && off < 0x8000) {
+        return -1;
+    }
+    return (int32_t)((((bank & 0x3F) << 16) | off) % ROM_SIZE);
+}
+
+static void branchy_read(enum iovm1_host_mapping m, uint24_t a, uint32_t l) {
+    const uint8_t *rom = host.chip[MEM_SNES_ROM].mem;
+
+    for (uint32_t i = 0; i < l; i++) {
+        int32_t o = branchy_translate(m, a + i);
+        if (o < 0) {
+            return;
+        }
+        buf[i] = rom[o];
+    }
+    on_reply(0, 0, IOVM1_HOST_REPLY_READ, buf, l);
+}
+
+static void table_read(struct iovm1_t *vm, uint24_t a, uint32_t l) {
+    vm->rd.os = IOVM1_OPSTATE_INIT;
+    vm->rd.c = MEM_SNES_ROM;
+    vm->rd.a = a;
+    vm->rd.l = (int)l;
+    do {
+        iovm1_host_read_state_machine(&host, vm);
+    } while (vm->rd.os != IOVM1_OPSTATE_COMPLETED);
+}
+
+static void run(const char *name, enum iovm1_host_mapping m, uint32_t l, int reps) {
+    struct iovm1_t vm;
+    uint64_t t0, t1, t2;
+
+    iovm1_host_set_mapping(&host, m);
+    for (int i = 0; i < ACCESSES; i++) {
+        // random mapped addresses, leaving room for `l` bytes before the window ends:
+        uint24_t bank = (uint24_t)(rand() & 0x3F);
+        uint24_t off = (uint24_t)(0x8000 + (rand() % (0x8000 - l)));
+        addrs[i] = (m == IOVM1_HOST_MAPPING_LOROM ? bank : 0xC0 + bank) << 16 | off;
+    }
+
+    iovm1_init(&vm);
+    t0 = now_ns();
+    for (int r = 0; r < reps; r++) {
+        for (int i = 0; i < ACCESSES; i++) {
+            branchy_read(m, addrs[i], l);
+        }
+    }
+    t1 = now_ns();
+    for (int r = 0; r < reps; r++) {
+        for (int i = 0; i < ACCESSES; i++) {
+            table_read(&vm, addrs[i], l);
+        }
+    }
+    t2 = now_ns();
+
+    fprintf(stdout, "%-12s %6u %14.1f %14.1f %8.2fx\n",
+        name, l,
+        (double)(t1 - t0) / ((double)reps * ACCESSES),
+        (double)(t2 - t1) / ((double)reps * ACCESSES),
+        (double)(t1 - t0) / (double)(t2 - t1));
+}
+
+int main(int argc, char **argv) {
+    int reps = 200;
+
+    if (argc > 1) {
+        reps = atoi(argv[1]);
+    }
+    if (iovm1_host_init(&host, ROM_SIZE, 0) != 0) {
+        fprintf(stderr, "could not allocate host memory\n");
+        return 1;
+    }
+    host.reply = on_reply;
+    for (uint32_t i = 0; i < ROM_SIZE; i++) {
+        host.chip[MEM_SNES_ROM].mem[i] = (uint8_t)(i * 31);
+    }
+
+    fprintf(stdout, "%-12s %6s %14s %14s %9s\n", "mapping", "bytes", "branchy ns", "table ns", "speedup");
+    run("lorom", IOVM1_HOST_MAPPING_LOROM, 1, reps);
+    run("lorom", IOVM1_HOST_MAPPING_LOROM, 16, reps);
+    run("lorom", IOVM1_HOST_MAPPING_LOROM, 256, reps);
+    run("hirom", IOVM1_HOST_MAPPING_HIROM, 1, reps);
+    run("hirom", IOVM1_HOST_MAPPING_HIROM, 16, reps);
+    run("hirom", IOVM1_HOST_MAPPING_HIROM, 256, reps);
+
+    iovm1_host_free(&host);
+    return 0;
+}
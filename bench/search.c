@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../iovm.h"
+
+// SEARCH throughput over a 4 MiB ROM image
+
+#define ROM_SIZE (4UL << 20)
+
+static uint8_t rom[ROM_SIZE];
+static int found_count;
+static uint24_t found[256];
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// minimal host serving ROM only:
+///////////////////////////////////////////////////////////////////////////////////////////
+
+enum iovm1_error host_memory_read_state_machine(struct iovm1_t *vm) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+enum iovm1_error host_memory_write_state_machine(struct iovm1_t *vm) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+enum iovm1_error host_memory_wait_state_machine(struct iovm1_t *vm) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+enum iovm1_error host_memory_verify_state_machine(struct iovm1_t *vm) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+enum iovm1_error host_memory_search_state_machine(struct iovm1_t *vm) {
+    const uint8_t *k = vm->sr.k ? &vm->m.ptr[vm->sr.k] : 0;
+    const uint8_t *h;
+    uint32_t hl;
+
+    if (vm->sr.c != MEM_SNES_ROM) {
+        return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+    }
+    if (vm->sr.a + vm->sr.l > ROM_SIZE) {
+        return IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE;
+    }
+
+    h = rom + vm->sr.a;
+    hl = vm->sr.l;
+    found_count = 0;
+    while (found_count < vm->sr.m) {
+        uint32_t i = iovm1_memory_search(h, hl, &vm->m.ptr[vm->sr.p], k, vm->sr.n);
+        if (i == hl) {
+            break;
+        }
+        found[found_count++] = (uint24_t)(h + i - rom);
+        h += i + 1;
+        hl -= i + 1;
+    }
+
+    vm->sr.os = IOVM1_OPSTATE_COMPLETED;
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t *b) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+enum iovm1_error host_memory_try_write_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t b) {
+    return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+}
+
+void host_send_end(struct iovm1_t *vm) {}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// benchmark:
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// byte-at-a-time reference for comparison:
+static uint32_t naive_search(const uint8_t *h, uint32_t hl, const uint8_t *pattern, const uint8_t *mask, int n) {
+    for (uint32_t i = 0; i + n <= hl; i++) {
+        int t = 0;
+        while (t < n && (h[i + t] & (mask ? mask[t] : 0xFF)) == (pattern[t] & (mask ? mask[t] : 0xFF))) {
+            t++;
+        }
+        if (t == n) {
+            return i;
+        }
+    }
+    return hl;
+}
+
+static void report(const char *name, double t, int reps) {
+    fprintf(stdout, "%-24s %9.3f ms/search %9.1f MiB/s\n",
+        name, t * 1e3 / reps, (double)ROM_SIZE * reps / t / (1 << 20));
+}
+
+int main(int argc, char **argv) {
+    (void) argc;
+    (void) argv;
+
+    const int reps = 20;
+    uint8_t sig[8] = { 0x4C, 0x00, 0x80, 0x5C, 0x12, 0x34, 0x56, 0x78 };
+    uint8_t sig_mask[8] = { 0xFF, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    volatile uint32_t sink = 0;
+    double t;
+
+    // pseudo-random ROM contents with the signature planted near the end:
+    uint32_t x = 0x12345678;
+    for (unsigned long i = 0; i < ROM_SIZE; i++) {
+        x = x * 1103515245 + 12345;
+        rom[i] = (uint8_t)(x >> 16);
+    }
+    memcpy(rom + ROM_SIZE - 4096, sig, sizeof(sig));
+
+    t = now();
+    for (int r = 0; r < reps; r++) {
+        sink += naive_search(rom, ROM_SIZE, sig, 0, sizeof(sig));
+    }
+    report("naive", now() - t, reps);
+
+    t = now();
+    for (int r = 0; r < reps; r++) {
+        sink += iovm1_memory_search(rom, ROM_SIZE, sig, 0, sizeof(sig));
+    }
+    report("iovm1_memory_search", now() - t, reps);
+
+    t = now();
+    for (int r = 0; r < reps; r++) {
+        sink += naive_search(rom, ROM_SIZE, sig, sig_mask, sizeof(sig));
+    }
+    report("naive masked", now() - t, reps);
+
+    t = now();
+    for (int r = 0; r < reps; r++) {
+        sink += iovm1_memory_search(rom, ROM_SIZE, sig, sig_mask, sizeof(sig));
+    }
+    report("iovm1_memory_search mask", now() - t, reps);
+
+    // full SEARCH instruction through iovm1_exec():
+    uint8_t proc[11 + 8] = {
+        IOVM1_MK_SEARCH(0),
+        MEM_SNES_ROM,
+        0x00,
+        0x00,
+        0x00,
+        (uint8_t)(ROM_SIZE), (uint8_t)(ROM_SIZE >> 8), (uint8_t)(ROM_SIZE >> 16),
+        sizeof(sig),
+        0x00,
+    };
+    memcpy(proc + 10, sig, sizeof(sig));
+
+    struct iovm1_t vm;
+    iovm1_init(&vm);
+    iovm1_load(&vm, proc, 10 + sizeof(sig));
+    t = now();
+    for (int r = 0; r < reps; r++) {
+        iovm1_exec_reset(&vm);
+        iovm1_exec(&vm);
+    }
+    report("SEARCH instruction", now() - t, reps);
+
+    if (found_count != 1 || found[0] != ROM_SIZE - 4096) {
+        fprintf(stdout, "unexpected search result\n");
+        return 1;
+    }
+
+    (void) sink;
+    return 0;
+}
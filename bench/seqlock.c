@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../iovm.h"
+#include "../iovm_host.h"
+
+// READ throughput, torn replies and seqlock waits and retries while the reference host's game thread rewrites the memory
+// being read, with and without `seqlock`
+
+#define REGION_ADDR 0x2000
+#define REGION_SIZE 0x8000
+#define READS 64
+
+static struct iovm1_host_t host;
+static struct iovm1_host_game_t game;
+static uint8_t proc[READS * 6];
+static uint64_t replies;
+static uint64_t torn;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// the game thread steps every byte of the region together, so a consistent reply has all bytes equal:
+static void on_reply(void *ctx, struct iovm1_t *vm, enum iovm1_host_reply r, const uint8_t *d, uint32_t l) {
+    replies++;
+    for (uint32_t i = 1; i < l; i++) {
+        if (d[i] != d[0]) {
+            torn++;
+            return;
+        }
+    }
+}
+
+static void run(const char *name, int seqlock, uint32_t hz, int runs) {
+    struct iovm1_t vm;
+    uint64_t t0, t1;
+    uint64_t waits0, retries0;
+
+    host.seqlock = seqlock;
+    replies = 0;
+    torn = 0;
+    waits0 = host.seq_waits;
+    retries0 = host.seq_retries;
+
+    iovm1_init(&vm);
+    iovm1_load(&vm, proc, sizeof(proc));
+
+    iovm1_host_game_init(&game, &host, hz, 0x1A);
+    iovm1_host_game_add_region(&game, MEM_SNES_WRAM, REGION_ADDR, REGION_SIZE, 1);
+    if (hz && iovm1_host_game_start(&game) != 0) {
+        fprintf(stderr, "could not start game thread\n");
+        exit(1);
+    }
+
+    t0 = now_ns();
+    for (int i = 0; i < runs; i++) {
+        iovm1_exec_reset(&vm);
+        do {
+            iovm1_exec(&vm);
+        } while (iovm1_get_exec_state(&vm) < IOVM1_STATE_ENDED);
+    }
+    t1 = now_ns();
+
+    if (hz) {
+        iovm1_host_game_stop(&game);
+    }
+
+    fprintf(stdout, "%-16s %8u %12.1f %10.1f %10llu %10llu %10llu %10llu\n",
+        name, hz,
+        (double)(t1 - t0) / (double)replies,
+        (double)replies * 256.0 / 1048576.0 / ((double)(t1 - t0) / 1e9),
+        (unsigned long long)replies,
+        (unsigned long long)torn,
+        (unsigned long long)(host.seq_waits - waits0),
+        (unsigned long long)(host.seq_retries - retries0));
+}
+
+int main(int argc, char **argv) {
+    uint32_t hz = 20000;
+    int runs = 20000;
+    uint8_t *p = proc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--hz") == 0 && i + 1 < argc) {
+            hz = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--hz <n>] [--runs <n>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (iovm1_host_init(&host, 0, 0) != 0) {
+        fprintf(stderr, "could not allocate host memory\n");
+        return 1;
+    }
+    host.reply = on_reply;
+    iovm1_host_default = &host;
+
+    // 64 full 256-byte READs spread over the region:
+    for (int i = 0; i < READS; i++) {
+        uint24_t a = REGION_ADDR + (uint24_t)(i * 512);
+        *p++ = IOVM1_OPCODE_READ;
+        *p++ = MEM_SNES_WRAM;
+        *p++ = (uint8_t)a;
+        *p++ = (uint8_t)(a >> 8);
+        *p++ = (uint8_t)(a >> 16);
+        *p++ = 0;
+    }
+
+    fprintf(stdout, "%-16s %8s %12s %10s %10s %10s %10s %10s\n",
+        "seqlock", "hz", "ns/read", "MiB/s", "reads", "torn", "waits", "retries");
+    run("idle off", 0, 0, runs);
+    run("idle on", 1, 0, runs);
+    run("loaded off", 0, hz, runs);
+    run("loaded on", 1, hz, runs);
+
+    iovm1_host_free(&host);
+    return 0;
+}
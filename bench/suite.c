@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../iovm.h"
+#include "../iovm_host.h"
+#include "bench.h"
+
+// iovm1_exec() benchmark suite against the reference host
+
+static struct iovm1_host_t host;
+static volatile uint32_t sink;
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// reference host callbacks:
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static void on_reply(void *ctx, struct iovm1_t *vm, enum iovm1_host_reply r, const uint8_t *d, uint32_t l) {
+    sink += d[0] + l;
+}
+
+// each unsuccessful poll advances the polled byte by one, like a frame counter ticking between polls:
+static void on_tick(void *ctx, struct iovm1_t *vm) {
+    host.chip[vm->wa.c].mem[vm->wa.a]++;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// program builders:
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t *emit_addr(uint8_t *p, enum iovm1_memory_chip c, uint24_t a) {
+    *p++ = (uint8_t)c;
+    *p++ = (uint8_t)a;
+    *p++ = (uint8_t)(a >> 8);
+    *p++ = (uint8_t)(a >> 16);
+    return p;
+}
+
+static uint8_t *emit_read(uint8_t *p, enum iovm1_memory_chip c, uint24_t a, int l) {
+    *p++ = IOVM1_OPCODE_READ;
+    p = emit_addr(p, c, a);
+    *p++ = (uint8_t)l;
+    return p;
+}
+
+static uint8_t *emit_write(uint8_t *p, enum iovm1_memory_chip c, uint24_t a, int l) {
+    *p++ = IOVM1_OPCODE_WRITE;
+    p = emit_addr(p, c, a);
+    *p++ = (uint8_t)l;
+    for (int i = 0; i < (l ? l : 256); i++) {
+        *p++ = (uint8_t)i;
+    }
+    return p;
+}
+
+static uint8_t *emit_cmp(uint8_t *p, uint8_t x, enum iovm1_memory_chip c, uint24_t a, uint8_t v, uint8_t k) {
+    *p++ = x;
+    p = emit_addr(p, c, a);
+    *p++ = v;
+    *p++ = k;
+    return p;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// cases:
+///////////////////////////////////////////////////////////////////////////////////////////
+
+struct vm_case {
+    struct iovm1_t vm;
+    uint8_t proc[8192];
+    uint32_t len;
+    uint64_t insts;
+    // runs of the program per repetition:
+    int runs;
+    void (*before_run)(void);
+};
+
+static void run_to_end(struct iovm1_t *vm) {
+    iovm1_exec_reset(vm);
+    do {
+        iovm1_exec(vm);
+    } while (iovm1_get_exec_state(vm) < IOVM1_STATE_ENDED);
+    if (iovm1_get_exec_state(vm) != IOVM1_STATE_ENDED) {
+        fprintf(stderr, "program errored with %d at %u\n", vm->e, vm->p);
+        exit(1);
+    }
+}
+
+static void vm_case_fn(void *arg) {
+    struct vm_case *vc = arg;
+
+    for (int i = 0; i < vc->runs; i++) {
+        if (vc->before_run) {
+            vc->before_run();
+        }
+        run_to_end(&vc->vm);
+    }
+}
+
+static void vm_case_load(struct vm_case *vc, uint8_t *end, uint64_t insts, int runs) {
+    vc->len = (uint32_t)(end - vc->proc);
+    vc->insts = insts * (uint64_t)runs;
+    vc->runs = runs;
+
+    iovm1_init(&vc->vm);
+    iovm1_load(&vc->vm, vc->proc, vc->len);
+    if (iovm1_verify(&vc->vm) != IOVM1_SUCCESS) {
+        fprintf(stderr, "program failed verification at %u\n", vc->vm.p);
+        exit(1);
+    }
+}
+
+// 1024 single-byte READs spread over WRAM: dominated by decode and dispatch
+static void build_decode(struct vm_case *vc) {
+    uint8_t *p = vc->proc;
+    for (int i = 0; i < 1024; i++) {
+        p = emit_read(p, MEM_SNES_WRAM, (uint24_t)(i * 17) & 0xFFFF, 1);
+    }
+    vm_case_load(vc, p, 1024, 1);
+}
+
+// 32 full 256-byte READs:
+static void build_read(struct vm_case *vc) {
+    uint8_t *p = vc->proc;
+    for (int i = 0; i < 32; i++) {
+        p = emit_read(p, MEM_SNES_WRAM, (uint24_t)(i * 256), 0);
+    }
+    vm_case_load(vc, p, 32, 1);
+}
+
+// 28 full 256-byte WRITEs:
+static void build_write(struct vm_case *vc) {
+    uint8_t *p = vc->proc;
+    for (int i = 0; i < 28; i++) {
+        p = emit_write(p, MEM_SNES_WRAM, (uint24_t)(0x8000 + i * 256), 0);
+    }
+    vm_case_load(vc, p, 28, 1);
+}
+
+static void wait_before_run(void) {
+    host.chip[MEM_SNES_WRAM].mem[0x10] = 0;
+}
+
+// one WAIT_UNTIL which completes after 64 polls:
+static void build_wait(struct vm_case *vc) {
+    uint8_t *p = vc->proc;
+    p = emit_cmp(p, IOVM1_MK_WAIT_UNTIL(IOVM1_CMP_EQ), MEM_SNES_WRAM, 0x10, 64, 0xFF);
+    vm_case_load(vc, p, 1, 16);
+    vc->before_run = wait_before_run;
+}
+
+// 1024 passing ABORT_UNLESS checks:
+static void build_abort(struct vm_case *vc) {
+    uint8_t *p = vc->proc;
+    for (int i = 0; i < 1024; i++) {
+        p = emit_cmp(p, IOVM1_MK_ABORT_UNLESS(IOVM1_CMP_NEQ), MEM_SNES_WRAM, (uint24_t)(0x100 + i), 0xFF, 0xFF);
+    }
+    vm_case_load(vc, p, 1024, 1);
+}
+
+// a 2 instruction program reset and re-run 1000 times:
+static void build_rerun(struct vm_case *vc) {
+    uint8_t *p = vc->proc;
+    p = emit_cmp(p, IOVM1_MK_ABORT_UNLESS(IOVM1_CMP_NEQ), MEM_SNES_WRAM, 0x20, 0xFF, 0xFF);
+    p = emit_read(p, MEM_SNES_WRAM, 0x20, 2);
+    vm_case_load(vc, p, 2, 1000);
+}
+
+#define MANY_VMS 64
+
+struct many_case {
+    struct iovm1_t vm[MANY_VMS];
+    uint8_t proc[MANY_VMS][16 * 7];
+    uint64_t insts;
+};
+
+// 64 VMs of 16 instructions each stepped round-robin, one iovm1_exec() per VM per pass:
+static void many_fn(void *arg) {
+    struct many_case *mc = arg;
+    int running;
+
+    for (int i = 0; i < MANY_VMS; i++) {
+        iovm1_exec_reset(&mc->vm[i]);
+    }
+    do {
+        running = 0;
+        for (int i = 0; i < MANY_VMS; i++) {
+            if (iovm1_get_exec_state(&mc->vm[i]) < IOVM1_STATE_ENDED) {
+                iovm1_exec(&mc->vm[i]);
+                running = 1;
+            }
+        }
+    } while (running);
+}
+
+static void build_many(struct many_case *mc) {
+    for (int i = 0; i < MANY_VMS; i++) {
+        uint8_t *p = mc->proc[i];
+        for (int j = 0; j < 16; j++) {
+            if (j & 1) {
+                p = emit_cmp(p, IOVM1_MK_RMW(IOVM1_ALU_ADD), MEM_SNES_WRAM, (uint24_t)(0x1000 + i * 16 + j), 1, 0);
+            } else {
+                p = emit_read(p, MEM_SNES_WRAM, (uint24_t)(0x2000 + i * 64), 4);
+            }
+        }
+        iovm1_init(&mc->vm[i]);
+        iovm1_load(&mc->vm[i], mc->proc[i], (uint32_t)(p - mc->proc[i]));
+    }
+    mc->insts = MANY_VMS * 16;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// main:
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static struct vm_case cases[6];
+static struct many_case many;
+
+int main(int argc, char **argv) {
+    static struct bench_result results[7];
+    static struct bench_result base[64];
+    const char *json_path = 0;
+    const char *baseline_path = 0;
+    const char *filter = 0;
+    const char *wram_path = 0;
+    double threshold = 0.05;
+    int reps = 1000;
+    int runs = 5;
+    int perf = 0;
+    int n = 0;
+    int nb = 0;
+
+    static const struct {
+        const char *name;
+        void (*build)(struct vm_case *vc);
+    } defs[6] = {
+        { "decode", build_decode },
+        { "read", build_read },
+        { "write", build_write },
+        { "wait_poll", build_wait },
+        { "abort_chain", build_abort },
+        { "reset_rerun", build_rerun },
+    };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]) / 100.0;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--wram") == 0 && i + 1 < argc) {
+            wram_path = argv[++i];
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            perf = 1;
+        } else {
+            fprintf(stderr,
+                "usage: %s [--json <file>] [--baseline <file>] [--threshold <percent>] [--filter <substring>]\n"
+                "       [--reps <n>] [--runs <n>] [--wram <dump>] [--perf]\n",
+                argv[0]);
+            return 2;
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    if (runs < 1) {
+        runs = 1;
+    }
+
+    if (iovm1_host_init(&host, 4UL << 20, 32UL << 10) != 0) {
+        fprintf(stderr, "could not allocate host memory\n");
+        return 1;
+    }
+    host.reply = on_reply;
+    host.tick = on_tick;
+    iovm1_host_default = &host;
+
+    // run against a recorded 128 KiB WRAM dump; the benchmarks' writes stay private:
+    if (wram_path &&
+        iovm1_host_map_file(&host, MEM_SNES_WRAM, wram_path, 0, 0x20000, IOVM1_HOST_MAP_COPY_ON_WRITE) != 0) {
+        perror(wram_path);
+        return 2;
+    }
+
+    // load the baseline first so a bad path fails fast:
+    if (baseline_path && (nb = bench_json_load(baseline_path, base, 64)) < 0) {
+        perror(baseline_path);
+        return 2;
+    }
+
+    // hardware counters are best effort:
+    if (perf) {
+        int available = bench_perf_open();
+        if (available < BENCH_COUNTERS) {
+            fprintf(stderr, "perf_event_open: %d of %d hardware counters available\n", available, BENCH_COUNTERS);
+        }
+    }
+
+    bench_print_header(stdout);
+    for (int i = 0; i < 6; i++) {
+        if (filter && !strstr(defs[i].name, filter)) {
+            continue;
+        }
+        defs[i].build(&cases[i]);
+        bench_run(&results[n], defs[i].name, vm_case_fn, &cases[i], cases[i].insts, reps / 10 + 1, reps, runs);
+        bench_print(stdout, &results[n++]);
+    }
+    if (!filter || strstr("many_vms", filter)) {
+        build_many(&many);
+        bench_run(&results[n], "many_vms", many_fn, &many, many.insts, reps / 10 + 1, reps, runs);
+        bench_print(stdout, &results[n++]);
+    }
+
+    if (perf) {
+        fprintf(stdout, "\n");
+        bench_print_perf_header(stdout);
+        for (int i = 0; i < n; i++) {
+            bench_print_perf(stdout, &results[i]);
+        }
+    }
+
+    if (json_path) {
+        FILE *f = fopen(json_path, "w");
+        if (!f) {
+            perror(json_path);
+            return 1;
+        }
+        bench_json(f, results, n);
+        fclose(f);
+    }
+
+    // nonzero exit on a significant regression against the baseline:
+    if (baseline_path) {
+        fprintf(stdout, "\n");
+        if (bench_compare(stdout, results, n, base, nb, threshold) > 0) {
+            return 3;
+        }
+    }
+
+    return 0;
+}
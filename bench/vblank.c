@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../iovm.h"
+#include "../iovm_host.h"
+
+// WAIT_UNTIL wake-up latency relative to the reference host's simulated vblank: each frame a WAIT_UNTIL on the
+// frame counter byte polls until the game thread increments it, and the time from the game thread's vblank
+// timestamp to the VM observing the wait as completed is recorded
+
+#define FRAME_ADDR 0x1A
+
+static struct iovm1_host_t host;
+static struct iovm1_host_game_t game;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint8_t proc[7] = {
+    IOVM1_MK_WAIT_UNTIL(IOVM1_CMP_EQ), MEM_SNES_WRAM, FRAME_ADDR, 0x00, 0x00, 0x00, 0xFF
+};
+
+int main(int argc, char **argv) {
+    struct iovm1_t vm;
+    uint64_t *lat;
+    uint64_t polls = 0;
+    uint32_t hz = 60;
+    int frames = 60;
+    int missed = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--hz") == 0 && i + 1 < argc) {
+            hz = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--hz <n>] [--frames <n>]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames < 1) {
+        frames = 1;
+    }
+
+    if (iovm1_host_init(&host, 0, 0) != 0 || !(lat = calloc((size_t)frames, sizeof(*lat)))) {
+        fprintf(stderr, "could not allocate host memory\n");
+        return 1;
+    }
+    iovm1_host_default = &host;
+
+    iovm1_host_game_init(&game, &host, hz, FRAME_ADDR);
+    // a few scripted regions so every frame writes memory besides the counter:
+    iovm1_host_game_add_region(&game, MEM_SNES_WRAM, 0x0400, 0x100, 1);
+    iovm1_host_game_add_region(&game, MEM_SNES_OAM, 0x000, 0x220, 3);
+
+    iovm1_init(&vm);
+    iovm1_load(&vm, proc, sizeof(proc));
+    if (iovm1_verify(&vm) != IOVM1_SUCCESS) {
+        fprintf(stderr, "program failed verification\n");
+        return 1;
+    }
+
+    if (iovm1_host_game_start(&game) != 0) {
+        fprintf(stderr, "could not start game thread\n");
+        return 1;
+    }
+
+    for (int i = 0; i < frames; i++) {
+        uint8_t next = (uint8_t)(__atomic_load_n(&host.chip[MEM_SNES_WRAM].mem[FRAME_ADDR], __ATOMIC_ACQUIRE) + 1);
+        uint32_t frame;
+        uint64_t t;
+
+        proc[5] = next;
+        iovm1_exec_reset(&vm);
+        do {
+            iovm1_exec(&vm);
+            polls++;
+        } while (iovm1_get_exec_state(&vm) < IOVM1_STATE_ENDED);
+        t = now_ns();
+
+        frame = __atomic_load_n(&host.frame, __ATOMIC_RELAXED);
+        lat[i] = t - __atomic_load_n(&game.vblank_ns, __ATOMIC_RELAXED);
+        // the counter moved past `next` before we observed it, so the latency is not for the awaited frame:
+        if (iovm1_get_exec_state(&vm) != IOVM1_STATE_ENDED || (uint8_t)frame != next) {
+            missed++;
+        }
+    }
+
+    iovm1_host_game_stop(&game);
+
+    qsort(lat, (size_t)frames, sizeof(*lat), cmp_u64);
+    fprintf(stdout, "%-12s %8s %8s %10s %10s %10s %10s %12s\n",
+        "vblank", "hz", "frames", "min ns", "median ns", "p99 ns", "max ns", "polls/frame");
+    fprintf(stdout, "%-12s %8u %8d %10llu %10llu %10llu %10llu %12.0f\n",
+        "wait_wake", hz, frames,
+        (unsigned long long)lat[0],
+        (unsigned long long)lat[frames / 2],
+        (unsigned long long)lat[(frames * 99) / 100 < frames ? (frames * 99) / 100 : frames - 1],
+        (unsigned long long)lat[frames - 1],
+        (double)polls / frames);
+    if (missed) {
+        fprintf(stdout, "%d frames missed\n", missed);
+    }
+
+    free(lat);
+    iovm1_host_free(&host);
+    return 0;
+}
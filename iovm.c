@@ -1,3 +1,9 @@
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "iovm.h"
 
 #ifdef __cplusplus
@@ -6,6 +12,25 @@ extern "C" {
 
 // iovm implementation
 
+#ifdef IOVM1_USE_HOOKS
+#define IOVM1_HOOK(vm, h, arg) host_hook(vm, h, (uint32_t)(arg))
+#else
+#define IOVM1_HOOK(vm, h, arg) ((void)0)
+#endif
+
+// hook with the opcode of the current instruction:
+#define IOVM1_HOOK_INST(vm, h) IOVM1_HOOK(vm, h, IOVM1_INST_OPCODE((vm)->m.ptr[(vm)->p]))
+
+static inline void iovm1_set_state(struct iovm1_t *vm, enum iovm1_state s) {
+#ifdef IOVM1_USE_HOOKS
+    enum iovm1_state o = vm->s;
+    vm->s = s;
+    host_hook(vm, IOVM1_HOOK_STATE, o);
+#else
+    vm->s = s;
+#endif
+}
+
 void iovm1_init(struct iovm1_t *vm) {
     vm->s = IOVM1_STATE_INIT;
 
@@ -13,6 +38,18 @@ void iovm1_init(struct iovm1_t *vm) {
     vm->userdata = 0;
 #endif
 
+#ifdef IOVM1_USE_CHIP_TABLE
+    vm->chips = 0;
+    vm->chips_len = 0;
+#endif
+#ifdef IOVM1_USE_ACL
+    vm->acl = 0;
+    vm->acl_len = 0;
+#endif
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+    vm->access_verified = false;
+#endif
+
     vm->m.ptr = 0;
     vm->m.len = 0;
     vm->m.off = 0;
@@ -33,9 +70,323 @@ enum iovm1_error iovm1_load(struct iovm1_t *vm, const uint8_t *proc, unsigned le
     vm->m.len = len;
     vm->m.off = 0;
     vm->next_off = 0;
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+    vm->access_verified = false;
+#endif
+
+    iovm1_set_state(vm, IOVM1_STATE_LOADED);
+
+    return IOVM1_SUCCESS;
+}
+
+// decodes the size in bytes of the instruction at `off`; fails if it is undefined or does not fit in program memory
+static enum iovm1_error iovm1_inst_size(const uint8_t *m, uint32_t len, uint32_t off, uint32_t *size) {
+    uint8_t x = m[off];
+    uint32_t n;
+
+    switch (IOVM1_INST_OPCODE(x)) {
+        case IOVM1_OPCODE_READ:
+            n = 6;
+            break;
+        case IOVM1_OPCODE_WRITE:
+        case IOVM1_OPCODE_WRITE_VERIFY:
+        case IOVM1_OPCODE_COMPARE:
+            if (off + 6 > len) {
+                return IOVM1_ERROR_OUT_OF_RANGE;
+            }
+            // translate 0 -> 256:
+            n = m[off + 5];
+            if (n == 0) { n = 256; }
+            n += 6;
+            break;
+        case IOVM1_OPCODE_WAIT_UNTIL:
+        case IOVM1_OPCODE_ABORT_UNLESS:
+            n = 7;
+            break;
+        case IOVM1_OPCODE_RMW:
+            if (IOVM1_INST_ALU_OPERATOR(x) > IOVM1_ALU_ADD) {
+                return IOVM1_ERROR_UNKNOWN_OPCODE;
+            }
+            n = 7;
+            break;
+        case IOVM1_OPCODE_CAS:
+            n = 8;
+            break;
+        case IOVM1_OPCODE_SEARCH:
+            if (off + 10 > len) {
+                return IOVM1_ERROR_OUT_OF_RANGE;
+            }
+            n = m[off + 8];
+            if (n == 0 || n > IOVM1_SEARCH_MAX_PATTERN) {
+                return IOVM1_ERROR_OUT_OF_RANGE;
+            }
+            // pattern plus optional mask:
+            n <<= (x >> 2) & 1;
+            n += 10;
+            break;
+        case IOVM1_OPCODE_SKIP_UNLESS:
+            n = 9;
+            break;
+        default:
+            return IOVM1_ERROR_UNKNOWN_OPCODE;
+    }
+
+    if (off + n > len) {
+        return IOVM1_ERROR_OUT_OF_RANGE;
+    }
+
+    *size = n;
+    return IOVM1_SUCCESS;
+}
+
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+#define IOVM1_ACCESS_READ   (1 << 0)
+#define IOVM1_ACCESS_WRITE  (1 << 1)
+
+// decodes the memory access of the instruction at `m`; every memory instruction carries its chip at `m[1]` and its
+// 24-bit address at `m[2]`. returns false for instructions without one
+static inline bool iovm1_inst_access(const uint8_t *m, uint8_t *c, uint32_t *a, uint32_t *l, uint8_t *rw) {
+    switch (IOVM1_INST_OPCODE(m[0])) {
+        case IOVM1_OPCODE_READ:
+        case IOVM1_OPCODE_COMPARE:
+            *rw = IOVM1_ACCESS_READ;
+            *l = m[5] ? m[5] : 256;
+            break;
+        case IOVM1_OPCODE_WRITE:
+            *rw = IOVM1_ACCESS_WRITE;
+            *l = m[5] ? m[5] : 256;
+            break;
+        case IOVM1_OPCODE_WRITE_VERIFY:
+            *rw = IOVM1_ACCESS_READ | IOVM1_ACCESS_WRITE;
+            *l = m[5] ? m[5] : 256;
+            break;
+        case IOVM1_OPCODE_WAIT_UNTIL:
+        case IOVM1_OPCODE_ABORT_UNLESS:
+        case IOVM1_OPCODE_SKIP_UNLESS:
+            *rw = IOVM1_ACCESS_READ;
+            *l = 1;
+            break;
+        case IOVM1_OPCODE_RMW:
+        case IOVM1_OPCODE_CAS:
+            *rw = IOVM1_ACCESS_READ | IOVM1_ACCESS_WRITE;
+            *l = 1;
+            break;
+        case IOVM1_OPCODE_SEARCH:
+            *rw = IOVM1_ACCESS_READ;
+            *l = (uint32_t)m[5] | ((uint32_t)m[6] << 8) | ((uint32_t)m[7] << 16);
+            if (*l == 0) { *l = 1UL << 24; }
+            break;
+        default:
+            return false;
+    }
+
+    *c = m[1];
+    *a = (uint32_t)m[2] | ((uint32_t)m[3] << 8) | ((uint32_t)m[4] << 16);
+    return true;
+}
+#endif
+
+#ifdef IOVM1_USE_CHIP_TABLE
+void iovm1_set_chips(struct iovm1_t *vm, const struct iovm1_chip_t *chips, uint32_t len) {
+    vm->chips = chips;
+    vm->chips_len = chips ? len : 0;
+    vm->access_verified = false;
+}
+
+static inline enum iovm1_error iovm1_chip_check(const struct iovm1_t *vm, uint8_t c, uint32_t a, uint32_t l, uint8_t rw) {
+    const struct iovm1_chip_t *ch;
+
+    if (c >= vm->chips_len || vm->chips[c].size == 0) {
+        return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+    }
+    ch = &vm->chips[c];
+
+    if (!(ch->flags & IOVM1_CHIP_WRAP) && (a >= ch->size || l > ch->size - a)) {
+        return IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE;
+    }
+    if ((rw & IOVM1_ACCESS_READ) && !(ch->flags & IOVM1_CHIP_READABLE)) {
+        return IOVM1_ERROR_MEMORY_CHIP_NOT_READABLE;
+    }
+    if ((rw & IOVM1_ACCESS_WRITE) && !(ch->flags & IOVM1_CHIP_WRITABLE)) {
+        return IOVM1_ERROR_MEMORY_CHIP_NOT_WRITABLE;
+    }
+
+    return IOVM1_SUCCESS;
+}
+#endif
+
+#ifdef IOVM1_USE_ACL
+void iovm1_set_acl(struct iovm1_t *vm, const struct iovm1_acl_chip_t *acl, uint32_t len) {
+    vm->acl = acl;
+    vm->acl_len = acl ? len : 0;
+    vm->access_verified = false;
+}
+
+// mask of bits `lo` to `hi` inclusive within one 64-bit word:
+static inline uint64_t iovm1_acl_mask(uint32_t lo, uint32_t hi) {
+    return (~0ULL << lo) & (~0ULL >> (63 - hi));
+}
+
+void iovm1_acl_grant(uint64_t *bits, uint32_t pages, uint24_t a, uint32_t l) {
+    uint32_t p0 = a >> IOVM1_ACL_PAGE_SHIFT;
+    uint32_t p1 = (a + l - 1) >> IOVM1_ACL_PAGE_SHIFT;
+
+    if (l == 0 || p0 >= pages) {
+        return;
+    }
+    if (p1 >= pages) {
+        p1 = pages - 1;
+    }
+    for (uint32_t w = p0 >> 6; w <= p1 >> 6; w++) {
+        bits[w] |= iovm1_acl_mask(w == p0 >> 6 ? p0 & 63 : 0, w == p1 >> 6 ? p1 & 63 : 63);
+    }
+}
+
+void iovm1_acl_revoke(uint64_t *bits, uint32_t pages, uint24_t a, uint32_t l) {
+    uint32_t p0 = a >> IOVM1_ACL_PAGE_SHIFT;
+    uint32_t p1 = (a + l - 1) >> IOVM1_ACL_PAGE_SHIFT;
+
+    if (l == 0 || p0 >= pages) {
+        return;
+    }
+    if (p1 >= pages) {
+        p1 = pages - 1;
+    }
+    for (uint32_t w = p0 >> 6; w <= p1 >> 6; w++) {
+        bits[w] &= ~iovm1_acl_mask(w == p0 >> 6 ? p0 & 63 : 0, w == p1 >> 6 ? p1 & 63 : 63);
+    }
+}
+
+bool iovm1_acl_test(const uint64_t *bits, uint32_t pages, uint24_t a, uint32_t l) {
+    uint32_t p0 = a >> IOVM1_ACL_PAGE_SHIFT;
+    uint32_t p1 = (a + l - 1) >> IOVM1_ACL_PAGE_SHIFT;
+    uint32_t w0, w1;
+
+    if (!bits || l == 0 || p1 >= pages) {
+        return false;
+    }
+
+    // ranges of up to 256 bytes touch at most two pages, usually within one word:
+    w0 = p0 >> 6;
+    w1 = p1 >> 6;
+    if (w0 == w1) {
+        uint64_t k = iovm1_acl_mask(p0 & 63, p1 & 63);
+        return (bits[w0] & k) == k;
+    }
+    if ((bits[w0] | ~iovm1_acl_mask(p0 & 63, 63)) != ~0ULL) {
+        return false;
+    }
+    for (uint32_t w = w0 + 1; w < w1; w++) {
+        if (bits[w] != ~0ULL) {
+            return false;
+        }
+    }
+    return (bits[w1] | ~iovm1_acl_mask(0, p1 & 63)) == ~0ULL;
+}
+
+static inline enum iovm1_error iovm1_acl_check(const struct iovm1_t *vm, uint8_t c, uint32_t a, uint32_t l, uint8_t rw) {
+    const struct iovm1_acl_chip_t *acl;
+
+    if (c >= vm->acl_len) {
+        return IOVM1_ERROR_ACCESS_DENIED;
+    }
+    acl = &vm->acl[c];
+
+    if ((rw & IOVM1_ACCESS_READ) && !iovm1_acl_test(acl->r, acl->pages, a, l)) {
+        return IOVM1_ERROR_ACCESS_DENIED;
+    }
+    if ((rw & IOVM1_ACCESS_WRITE) && !iovm1_acl_test(acl->w, acl->pages, a, l)) {
+        return IOVM1_ERROR_ACCESS_DENIED;
+    }
+
+    return IOVM1_SUCCESS;
+}
+#endif
+
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+// true when a chip table or ACL is registered:
+static inline bool iovm1_access_checked(const struct iovm1_t *vm) {
+    return false
+#ifdef IOVM1_USE_CHIP_TABLE
+        || vm->chips
+#endif
+#ifdef IOVM1_USE_ACL
+        || vm->acl
+#endif
+    ;
+}
+
+// validates an access of `l` bytes at `a` on chip `c` against the chip table and then the ACL:
+static enum iovm1_error iovm1_access_check_range(const struct iovm1_t *vm, uint8_t c, uint32_t a, uint32_t l, uint8_t rw) {
+    enum iovm1_error e = IOVM1_SUCCESS;
+
+#ifdef IOVM1_USE_CHIP_TABLE
+    if (vm->chips && (e = iovm1_chip_check(vm, c, a, l, rw)) != IOVM1_SUCCESS) {
+        return e;
+    }
+#endif
+#ifdef IOVM1_USE_ACL
+    if (vm->acl && (e = iovm1_acl_check(vm, c, a, l, rw)) != IOVM1_SUCCESS) {
+        return e;
+    }
+#endif
+
+    return e;
+}
+
+// validates the memory access of the instruction at `off`:
+static enum iovm1_error iovm1_access_check(const struct iovm1_t *vm, uint32_t off) {
+    uint32_t a, l;
+    uint8_t c, rw;
+
+    if (!iovm1_inst_access(vm->m.ptr + off, &c, &a, &l, &rw)) {
+        // no memory access, or an unknown opcode reported by the caller:
+        return IOVM1_SUCCESS;
+    }
 
-    vm->s = IOVM1_STATE_LOADED;
+    return iovm1_access_check_range(vm, c, a, l, rw);
+}
+#endif
 
+enum iovm1_error iovm1_verify(struct iovm1_t *vm) {
+    enum iovm1_error e;
+    uint32_t off, n;
+
+    if (vm->s != IOVM1_STATE_LOADED) {
+        return IOVM1_ERROR_INVALID_OPERATION_FOR_STATE;
+    }
+
+    for (off = 0; off < vm->m.len; off += n) {
+        vm->p = off;
+        if ((e = iovm1_inst_size(vm->m.ptr, vm->m.len, off, &n)) != IOVM1_SUCCESS) {
+            return e;
+        }
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+        if ((e = iovm1_access_check(vm, off)) != IOVM1_SUCCESS) {
+            return e;
+        }
+#endif
+
+        if (IOVM1_INST_OPCODE(vm->m.ptr[off]) == IOVM1_OPCODE_SKIP_UNLESS) {
+            // walk forward to the skip target; it must land on an instruction boundary or the end of the program:
+            uint32_t t = off + n + ((uint32_t)vm->m.ptr[off + 7] | ((uint32_t)vm->m.ptr[off + 8] << 8));
+            uint32_t i, in;
+            for (i = off + n; i < t && i < vm->m.len; i += in) {
+                if ((e = iovm1_inst_size(vm->m.ptr, vm->m.len, i, &in)) != IOVM1_SUCCESS) {
+                    // reported at the offending instruction when the outer walk reaches it:
+                    break;
+                }
+            }
+            if (e == IOVM1_SUCCESS && i != t) {
+                return IOVM1_ERROR_OUT_OF_RANGE;
+            }
+        }
+    }
+
+    vm->p = 0;
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+    vm->access_verified = iovm1_access_checked(vm);
+#endif
     return IOVM1_SUCCESS;
 }
 
@@ -57,11 +408,311 @@ enum iovm1_error iovm1_exec_reset(struct iovm1_t *vm) {
         return IOVM1_ERROR_INVALID_OPERATION_FOR_STATE;
     }
 
-    vm->s = IOVM1_STATE_RESET;
+    iovm1_set_state(vm, IOVM1_STATE_RESET);
+    return IOVM1_SUCCESS;
+}
+
+#if defined(IOVM1_USE_SUMMARY) || defined(IOVM1_USE_CHECKPOINT)
+static void iovm1_pack_le(uint8_t *d, uint64_t v, int n) {
+    for (int i = 0; i < n; i++) {
+        d[i] = (uint8_t)(v >> (i << 3));
+    }
+}
+#endif
+
+#ifdef IOVM1_USE_SUMMARY
+
+static uint32_t iovm1_saturate32(uint64_t v) {
+    return v > UINT32_MAX ? UINT32_MAX : (uint32_t)v;
+}
+
+void iovm1_summary_pack(struct iovm1_t *vm, uint8_t *d) {
+    d[0] = (uint8_t)vm->e;
+    iovm1_pack_le(d + 1, vm->s == IOVM1_STATE_ERRORED ? vm->p : vm->m.len, 3);
+    iovm1_pack_le(d + 4, vm->sum.t_start, 8);
+    iovm1_pack_le(d + 12, iovm1_saturate32(vm->sum.t_end - vm->sum.t_start), 4);
+    iovm1_pack_le(d + 16, iovm1_saturate32(vm->sum.t_wait), 4);
+    iovm1_pack_le(d + 20, vm->sum.frame_start, 4);
+    iovm1_pack_le(d + 24, vm->sum.frame_end, 4);
+    iovm1_pack_le(d + 28, vm->sum.insns, 4);
+}
+
+void iovm1_summary_pack_read_header(struct iovm1_t *vm, uint8_t *d) {
+    iovm1_pack_le(d + 0, host_clock_now(vm), 8);
+    iovm1_pack_le(d + 8, host_frame_counter(vm), 4);
+}
+#endif
+
+#ifdef IOVM1_USE_CHECKPOINT
+static uint64_t iovm1_unpack_le(const uint8_t *d, int n) {
+    uint64_t v = 0;
+    for (int i = n - 1; i >= 0; i--) {
+        v = (v << 8) | d[i];
+    }
+    return v;
+}
+
+// FNV-1a:
+uint64_t iovm1_program_hash(const uint8_t *proc, uint32_t len) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (uint32_t i = 0; i < len; i++) {
+        h = (h ^ proc[i]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+void iovm1_checkpoint(struct iovm1_t *vm, uint8_t *d) {
+    memset(d, 0, IOVM1_CHECKPOINT_SIZE);
+    memcpy(d, "IVC1", 4);
+    iovm1_pack_le(d + 4, iovm1_program_hash(vm->m.ptr, vm->m.len), 8);
+    iovm1_pack_le(d + 12, vm->m.len, 4);
+    d[16] = (uint8_t)vm->s;
+    d[17] = (uint8_t)vm->e;
+    iovm1_pack_le(d + 20, vm->p, 4);
+    iovm1_pack_le(d + 24, vm->next_off, 4);
+
+    // progress within the current instruction:
+    switch (vm->s) {
+        case IOVM1_STATE_READ:
+            d[28] = (uint8_t)vm->rd.os;
+            d[29] = (uint8_t)vm->rd.c;
+            iovm1_pack_le(d + 30, vm->rd.a, 3);
+            d[33] = vm->rd.l_raw;
+            iovm1_pack_le(d + 36, (uint32_t)vm->rd.l, 4);
+            break;
+        case IOVM1_STATE_WRITE:
+            d[28] = (uint8_t)vm->wr.os;
+            d[29] = (uint8_t)vm->wr.c;
+            iovm1_pack_le(d + 30, vm->wr.a, 3);
+            d[33] = vm->wr.l_raw;
+            iovm1_pack_le(d + 36, (uint32_t)vm->wr.l, 4);
+            iovm1_pack_le(d + 40, vm->wr.p, 4);
+            break;
+        case IOVM1_STATE_WAIT:
+            d[28] = (uint8_t)vm->wa.os;
+            d[29] = (uint8_t)vm->wa.c;
+            iovm1_pack_le(d + 30, vm->wa.a, 3);
+            d[33] = vm->wa.v;
+            d[34] = vm->wa.k;
+            d[35] = (uint8_t)vm->wa.q;
+            break;
+        case IOVM1_STATE_VERIFY:
+            d[28] = (uint8_t)vm->vf.os;
+            d[29] = (uint8_t)vm->vf.c;
+            iovm1_pack_le(d + 30, vm->vf.a, 3);
+            d[33] = vm->vf.l_raw;
+            d[34] = (uint8_t)vm->vf.r;
+            iovm1_pack_le(d + 36, (uint32_t)vm->vf.l, 4);
+            iovm1_pack_le(d + 40, vm->vf.p, 4);
+            break;
+        case IOVM1_STATE_SEARCH:
+            d[28] = (uint8_t)vm->sr.os;
+            d[29] = (uint8_t)vm->sr.c;
+            iovm1_pack_le(d + 30, vm->sr.a, 3);
+            d[33] = vm->sr.n;
+            iovm1_pack_le(d + 36, vm->sr.l, 4);
+            iovm1_pack_le(d + 40, vm->sr.p, 4);
+            iovm1_pack_le(d + 44, vm->sr.k, 4);
+            iovm1_pack_le(d + 48, (uint32_t)vm->sr.m, 2);
+            break;
+        default:
+            break;
+    }
+}
+
+// true if `[off, off+n)` lies within program memory:
+static inline bool iovm1_in_program(const struct iovm1_t *vm, uint32_t off, uint32_t n) {
+    return off <= vm->m.len && n <= vm->m.len - off;
+}
+
+// true if an instruction starts at `off` when decoding from the start of the program, or `off` is its end. `*size`
+// receives the size of that instruction, or 0 if there is none or it cannot be decoded
+static bool iovm1_inst_boundary(const struct iovm1_t *vm, uint32_t off, uint32_t *size) {
+    uint32_t i, n;
+
+    for (i = 0; i < off; i += n) {
+        if (iovm1_inst_size(vm->m.ptr, vm->m.len, i, &n) != IOVM1_SUCCESS) {
+            return false;
+        }
+    }
+    if (i != off) {
+        return false;
+    }
+
+    if (off >= vm->m.len || iovm1_inst_size(vm->m.ptr, vm->m.len, off, size) != IOVM1_SUCCESS) {
+        *size = 0;
+    }
+    return true;
+}
+
+enum iovm1_error iovm1_restore(struct iovm1_t *vm, const uint8_t *d) {
+    enum iovm1_state s = (enum iovm1_state)d[16];
+    uint32_t p = (uint32_t)iovm1_unpack_le(d + 20, 4);
+    uint32_t next_off = (uint32_t)iovm1_unpack_le(d + 24, 4);
+    enum iovm1_opstate os = (enum iovm1_opstate)d[28];
+    uint8_t c = d[29];
+    uint24_t a = (uint24_t)iovm1_unpack_le(d + 30, 3);
+    uint32_t l = (uint32_t)iovm1_unpack_le(d + 36, 4);
+    uint32_t dp = (uint32_t)iovm1_unpack_le(d + 40, 4);
+    uint32_t n;
+    uint8_t o = 0;
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+    uint8_t rw = IOVM1_ACCESS_READ;
+    uint32_t al = l;
+    enum iovm1_error e;
+#endif
+
+    if (vm->s != IOVM1_STATE_LOADED) {
+        return IOVM1_ERROR_INVALID_OPERATION_FOR_STATE;
+    }
+    if (memcmp(d, "IVC1", 4) != 0) {
+        return IOVM1_ERROR_OUT_OF_RANGE;
+    }
+    if (iovm1_unpack_le(d + 12, 4) != vm->m.len || iovm1_unpack_le(d + 4, 8) != iovm1_program_hash(vm->m.ptr, vm->m.len)) {
+        return IOVM1_ERROR_PROGRAM_MISMATCH;
+    }
+
+    // never trust offsets from outside; everything must stay within the loaded program:
+    if (s < IOVM1_STATE_LOADED || s > IOVM1_STATE_ERRORED || !iovm1_in_program(vm, p, 0) ||
+        !iovm1_in_program(vm, next_off, 0)) {
+        return IOVM1_ERROR_OUT_OF_RANGE;
+    }
+    // exec decodes from `next_off` and a verified program skips access checks, so both offsets must be instruction
+    // boundaries:
+    if (!iovm1_inst_boundary(vm, next_off, &n) || !iovm1_inst_boundary(vm, p, &n)) {
+        return IOVM1_ERROR_OUT_OF_RANGE;
+    }
+    if (s >= IOVM1_STATE_READ && s <= IOVM1_STATE_SEARCH) {
+        // the instruction at `p` is in progress and execution continues after it:
+        if (n == 0 || next_off != p + n || os > IOVM1_OPSTATE_COMPLETED) {
+            return IOVM1_ERROR_OUT_OF_RANGE;
+        }
+        o = IOVM1_INST_OPCODE(vm->m.ptr[p]);
+    }
+
+    switch (s) {
+        case IOVM1_STATE_READ:
+            if (o != IOVM1_OPCODE_READ || l > 256) {
+                return IOVM1_ERROR_OUT_OF_RANGE;
+            }
+            vm->rd.os = os;
+            vm->rd.c = (enum iovm1_memory_chip)c;
+            vm->rd.a = a;
+            vm->rd.l_raw = d[33];
+            vm->rd.l = (int)l;
+            break;
+        case IOVM1_STATE_WRITE:
+            if ((o != IOVM1_OPCODE_WRITE && o != IOVM1_OPCODE_WRITE_VERIFY) || l > 256 || !iovm1_in_program(vm, dp, l)) {
+                return IOVM1_ERROR_OUT_OF_RANGE;
+            }
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+            rw = IOVM1_ACCESS_WRITE;
+#endif
+            vm->wr.os = os;
+            vm->wr.c = (enum iovm1_memory_chip)c;
+            vm->wr.a = a;
+            vm->wr.l_raw = d[33];
+            vm->wr.l = (int)l;
+            vm->wr.p = dp;
+            break;
+        case IOVM1_STATE_WAIT:
+            if (o != IOVM1_OPCODE_WAIT_UNTIL) {
+                return IOVM1_ERROR_OUT_OF_RANGE;
+            }
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+            al = 1;
+#endif
+            vm->wa.os = os;
+            vm->wa.c = (enum iovm1_memory_chip)c;
+            vm->wa.a = a;
+            vm->wa.v = d[33];
+            vm->wa.k = d[34];
+            vm->wa.q = (enum iovm1_cmp_operator)(d[35] & 7);
+            break;
+        case IOVM1_STATE_VERIFY:
+            if ((o != IOVM1_OPCODE_COMPARE && o != IOVM1_OPCODE_WRITE_VERIFY) || l > 256 || !iovm1_in_program(vm, dp, l)) {
+                return IOVM1_ERROR_OUT_OF_RANGE;
+            }
+            vm->vf.os = os;
+            vm->vf.c = (enum iovm1_memory_chip)c;
+            vm->vf.a = a;
+            vm->vf.l_raw = d[33];
+            vm->vf.l = (int)l;
+            vm->vf.p = dp;
+            vm->vf.r = (enum iovm1_compare_reply)d[34];
+            break;
+        case IOVM1_STATE_SEARCH: {
+            uint32_t k = (uint32_t)iovm1_unpack_le(d + 44, 4);
+            uint32_t m = (uint32_t)iovm1_unpack_le(d + 48, 2);
+            uint8_t n = d[33];
+
+            if (o != IOVM1_OPCODE_SEARCH || l > (1UL << 24) || n == 0 || n > IOVM1_SEARCH_MAX_PATTERN ||
+                m == 0 || m > 256 || !iovm1_in_program(vm, dp, n) || (k && !iovm1_in_program(vm, k, n))) {
+                return IOVM1_ERROR_OUT_OF_RANGE;
+            }
+            vm->sr.os = os;
+            vm->sr.c = (enum iovm1_memory_chip)c;
+            vm->sr.a = a;
+            vm->sr.l = l;
+            vm->sr.n = n;
+            vm->sr.m = (int)m;
+            vm->sr.p = dp;
+            vm->sr.k = k;
+            break;
+        }
+        default:
+            break;
+    }
+
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+    // the remaining access was never checked against this VM's chip table or ACL:
+    if (s >= IOVM1_STATE_READ && s <= IOVM1_STATE_SEARCH && al && iovm1_access_checked(vm) &&
+        (e = iovm1_access_check_range(vm, c, a, al, rw)) != IOVM1_SUCCESS) {
+        return e;
+    }
+#endif
+
+    vm->p = p;
+    vm->next_off = next_off;
+    vm->m.off = next_off;
+    vm->e = (enum iovm1_error)d[17];
+#ifdef IOVM1_USE_SUMMARY
+    // the summary covers execution since the restore:
+    vm->sum.t_start = host_clock_now(vm);
+    vm->sum.t_end = vm->sum.t_start;
+    vm->sum.t_wait = 0;
+    vm->sum.t_wait_start = vm->sum.t_start;
+    vm->sum.frame_start = host_frame_counter(vm);
+    vm->sum.frame_end = vm->sum.frame_start;
+    vm->sum.insns = 0;
+#endif
+    iovm1_set_state(vm, s);
+
     return IOVM1_SUCCESS;
 }
+#endif
+
+// finalizes the summary and sends the program-end message:
+static inline void iovm1_send_end(struct iovm1_t *vm) {
+#ifdef IOVM1_USE_HOOKS
+    if (vm->s == IOVM1_STATE_ERRORED) {
+        IOVM1_HOOK_INST(vm, IOVM1_HOOK_INST_END);
+        IOVM1_HOOK(vm, IOVM1_HOOK_ERROR, vm->e);
+    }
+#endif
+#ifdef IOVM1_USE_SUMMARY
+    vm->sum.t_end = host_clock_now(vm);
+    vm->sum.frame_end = host_frame_counter(vm);
+    if (vm->s == IOVM1_STATE_ERRORED && vm->p < vm->m.len && IOVM1_INST_OPCODE(vm->m.ptr[vm->p]) == IOVM1_OPCODE_WAIT_UNTIL) {
+        // errored or timed out during WAIT_UNTIL:
+        vm->sum.t_wait += vm->sum.t_end - vm->sum.t_wait_start;
+    }
+#endif
+    host_send_end(vm);
+}
 
 enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vn, enum iovm1_memory_chip c, uint24_t a, uint8_t *b);
+enum iovm1_error host_memory_try_write_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t b);
 
 // executes the next IOVM instruction
 enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
@@ -72,16 +723,19 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
             return vm->e;
         case IOVM1_STATE_READ: {
         do_read:
+            IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_READ_STATE_MACHINE);
             vm->e = host_memory_read_state_machine(vm);
+            IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_READ_STATE_MACHINE);
             if (vm->e != IOVM1_SUCCESS) {
-                vm->s = IOVM1_STATE_ERRORED;
-                host_send_end(vm);
+                iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                iovm1_send_end(vm);
                 return vm->e;
             }
 
             if (vm->rd.os == IOVM1_OPSTATE_COMPLETED) {
                 // start next instruction:
-                vm->s = IOVM1_STATE_EXECUTE_NEXT;
+                IOVM1_HOOK_INST(vm, IOVM1_HOOK_INST_END);
+                iovm1_set_state(vm, IOVM1_STATE_EXECUTE_NEXT);
                 vm->e = IOVM1_SUCCESS;
                 break;
             }
@@ -92,16 +746,45 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
         }
         case IOVM1_STATE_WRITE: {
         do_write:
+            IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_WRITE_STATE_MACHINE);
             vm->e = host_memory_write_state_machine(vm);
+            IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_WRITE_STATE_MACHINE);
             if (vm->e != IOVM1_SUCCESS) {
-                vm->s = IOVM1_STATE_ERRORED;
-                host_send_end(vm);
+                iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                iovm1_send_end(vm);
                 return vm->e;
             }
 
             if (vm->wr.os == IOVM1_OPSTATE_COMPLETED) {
+                if (IOVM1_INST_OPCODE(vm->m.ptr[vm->p]) == IOVM1_OPCODE_WRITE_VERIFY) {
+                    // re-decode the instruction since the host may have advanced `vm->wr`:
+                    uint32_t off = vm->p + 1;
+
+                    // memory chip identifier:
+                    vm->vf.c = (enum iovm1_memory_chip)vm->m.ptr[off++];
+                    // 24-bit address:
+                    uint24_t lo = (uint24_t)(vm->m.ptr[off++]);
+                    uint24_t hi = (uint24_t)(vm->m.ptr[off++]) << 8;
+                    uint24_t bk = (uint24_t)(vm->m.ptr[off++]) << 16;
+                    vm->vf.a = bk | hi | lo;
+
+                    // length of verify in bytes:
+                    vm->vf.l_raw = vm->m.ptr[off++];
+                    // translate 0 -> 256:
+                    vm->vf.l = vm->vf.l_raw;
+                    if (vm->vf.l == 0) { vm->vf.l = 256; }
+
+                    // write complete; read back and compare against the written data:
+                    iovm1_set_state(vm, IOVM1_STATE_VERIFY);
+                    vm->vf.os = IOVM1_OPSTATE_INIT;
+                    vm->vf.p = off;
+                    vm->vf.r = IOVM1_INST_COMPARE_REPLY(vm->m.ptr[vm->p]);
+                    goto do_verify;
+                }
+
                 // write complete; start next instruction:
-                vm->s = IOVM1_STATE_EXECUTE_NEXT;
+                IOVM1_HOOK_INST(vm, IOVM1_HOOK_INST_END);
+                iovm1_set_state(vm, IOVM1_STATE_EXECUTE_NEXT);
                 vm->e = IOVM1_SUCCESS;
                 break;
             }
@@ -112,16 +795,68 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
         }
         case IOVM1_STATE_WAIT: {
         do_wait:
+            IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_WAIT_STATE_MACHINE);
             vm->e = host_memory_wait_state_machine(vm);
+            IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_WAIT_STATE_MACHINE);
             if (vm->e != IOVM1_SUCCESS) {
-                vm->s = IOVM1_STATE_ERRORED;
-                host_send_end(vm);
+                iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                iovm1_send_end(vm);
                 return vm->e;
             }
 
             if (vm->wa.os == IOVM1_OPSTATE_COMPLETED) {
+#ifdef IOVM1_USE_SUMMARY
+                vm->sum.t_wait += host_clock_now(vm) - vm->sum.t_wait_start;
+#endif
                 // wait complete; start next instruction:
-                vm->s = IOVM1_STATE_EXECUTE_NEXT;
+                IOVM1_HOOK_INST(vm, IOVM1_HOOK_INST_END);
+                iovm1_set_state(vm, IOVM1_STATE_EXECUTE_NEXT);
+                vm->e = IOVM1_SUCCESS;
+                break;
+            }
+
+            // host wants to be called back again:
+            vm->e = IOVM1_SUCCESS;
+            return vm->e;
+        }
+        case IOVM1_STATE_VERIFY: {
+        do_verify:
+            IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_VERIFY_STATE_MACHINE);
+            vm->e = host_memory_verify_state_machine(vm);
+            IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_VERIFY_STATE_MACHINE);
+            if (vm->e != IOVM1_SUCCESS) {
+                iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                iovm1_send_end(vm);
+                return vm->e;
+            }
+
+            if (vm->vf.os == IOVM1_OPSTATE_COMPLETED) {
+                // verify complete; start next instruction:
+                IOVM1_HOOK_INST(vm, IOVM1_HOOK_INST_END);
+                iovm1_set_state(vm, IOVM1_STATE_EXECUTE_NEXT);
+                vm->e = IOVM1_SUCCESS;
+                break;
+            }
+
+            // host wants to be called back again:
+            vm->e = IOVM1_SUCCESS;
+            return vm->e;
+        }
+        case IOVM1_STATE_SEARCH: {
+        do_search:
+            IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_SEARCH_STATE_MACHINE);
+            vm->e = host_memory_search_state_machine(vm);
+            IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_SEARCH_STATE_MACHINE);
+            if (vm->e != IOVM1_SUCCESS) {
+                iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                iovm1_send_end(vm);
+                return vm->e;
+            }
+
+            if (vm->sr.os == IOVM1_OPSTATE_COMPLETED) {
+                // search complete; start next instruction:
+                IOVM1_HOOK_INST(vm, IOVM1_HOOK_INST_END);
+                iovm1_set_state(vm, IOVM1_STATE_EXECUTE_NEXT);
                 vm->e = IOVM1_SUCCESS;
                 break;
             }
@@ -138,7 +873,7 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
                 return vm->e;
             }
             if (vm->s == IOVM1_STATE_LOADED) {
-                vm->s = IOVM1_STATE_RESET;
+                iovm1_set_state(vm, IOVM1_STATE_RESET);
             }
             if (vm->s == IOVM1_STATE_RESET) {
                 // reset execution state:
@@ -146,7 +881,15 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
                 vm->next_off = 0;
                 vm->p = 0;
                 vm->e = IOVM1_SUCCESS;
-                vm->s = IOVM1_STATE_EXECUTE_NEXT;
+                iovm1_set_state(vm, IOVM1_STATE_EXECUTE_NEXT);
+#ifdef IOVM1_USE_SUMMARY
+                vm->sum.t_start = host_clock_now(vm);
+                vm->sum.t_end = vm->sum.t_start;
+                vm->sum.t_wait = 0;
+                vm->sum.frame_start = host_frame_counter(vm);
+                vm->sum.frame_end = vm->sum.frame_start;
+                vm->sum.insns = 0;
+#endif
             }
             break;
     }
@@ -156,14 +899,28 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
         vm->p = vm->m.off;
 
         if (vm->m.off >= vm->m.len) {
-            vm->s = IOVM1_STATE_ENDED;
+            iovm1_set_state(vm, IOVM1_STATE_ENDED);
             vm->e = IOVM1_SUCCESS;
-            host_send_end(vm);
+            iovm1_send_end(vm);
             return vm->e;
         }
 
         // read instruction byte:
         uint8_t x = vm->m.ptr[vm->m.off++];
+        IOVM1_HOOK(vm, IOVM1_HOOK_INST_START, IOVM1_INST_OPCODE(x));
+#ifdef IOVM1_USE_SUMMARY
+        vm->sum.insns++;
+#endif
+
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+        // validate the whole access once here so host functions need not:
+        if (!vm->access_verified && iovm1_access_checked(vm) &&
+            (vm->e = iovm1_access_check(vm, vm->p)) != IOVM1_SUCCESS) {
+            iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+            iovm1_send_end(vm);
+            return vm->e;
+        }
+#endif
 
         // instruction opcode:
         uint8_t o = IOVM1_INST_OPCODE(x);
@@ -185,11 +942,12 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
                 if (vm->rd.l == 0) { vm->rd.l = 256; }
 
                 // perform entire read:
-                vm->s = IOVM1_STATE_READ;
+                iovm1_set_state(vm, IOVM1_STATE_READ);
                 vm->rd.os = IOVM1_OPSTATE_INIT;
                 goto do_read;
             }
-            case IOVM1_OPCODE_WRITE: {
+            case IOVM1_OPCODE_WRITE:
+            case IOVM1_OPCODE_WRITE_VERIFY: {
                 vm->next_off = vm->m.off + 5;
 
                 // memory chip identifier:
@@ -209,11 +967,85 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
                 vm->next_off += vm->wr.l;
 
                 // perform entire write:
-                vm->s = IOVM1_STATE_WRITE;
+                iovm1_set_state(vm, IOVM1_STATE_WRITE);
                 vm->wr.os = IOVM1_OPSTATE_INIT;
                 vm->wr.p = vm->m.off;
                 goto do_write;
             }
+            case IOVM1_OPCODE_COMPARE: {
+                vm->next_off = vm->m.off + 5;
+
+                vm->vf.r = IOVM1_INST_COMPARE_REPLY(x);
+
+                // memory chip identifier:
+                vm->vf.c = (enum iovm1_memory_chip)vm->m.ptr[vm->m.off++];
+                // 24-bit address:
+                uint24_t lo = (uint24_t)(vm->m.ptr[vm->m.off++]);
+                uint24_t hi = (uint24_t)(vm->m.ptr[vm->m.off++]) << 8;
+                uint24_t bk = (uint24_t)(vm->m.ptr[vm->m.off++]) << 16;
+                vm->vf.a = bk | hi | lo;
+
+                // length of compare in bytes:
+                vm->vf.l_raw = vm->m.ptr[vm->m.off++];
+                // translate 0 -> 256:
+                vm->vf.l = vm->vf.l_raw;
+                if (vm->vf.l == 0) { vm->vf.l = 256; }
+
+                vm->next_off += vm->vf.l;
+
+                // perform entire compare:
+                iovm1_set_state(vm, IOVM1_STATE_VERIFY);
+                vm->vf.os = IOVM1_OPSTATE_INIT;
+                vm->vf.p = vm->m.off;
+                goto do_verify;
+            }
+            case IOVM1_OPCODE_SEARCH: {
+                vm->next_off = vm->m.off + 9;
+
+                // memory chip identifier:
+                vm->sr.c = (enum iovm1_memory_chip)vm->m.ptr[vm->m.off++];
+                // 24-bit address:
+                uint24_t lo = (uint24_t)(vm->m.ptr[vm->m.off++]);
+                uint24_t hi = (uint24_t)(vm->m.ptr[vm->m.off++]) << 8;
+                uint24_t bk = (uint24_t)(vm->m.ptr[vm->m.off++]) << 16;
+                vm->sr.a = bk | hi | lo;
+
+                // 24-bit length of range in bytes:
+                lo = (uint24_t)(vm->m.ptr[vm->m.off++]);
+                hi = (uint24_t)(vm->m.ptr[vm->m.off++]) << 8;
+                bk = (uint24_t)(vm->m.ptr[vm->m.off++]) << 16;
+                vm->sr.l = bk | hi | lo;
+                // translate 0 -> 16 MiB:
+                if (vm->sr.l == 0) { vm->sr.l = 1UL << 24; }
+
+                // pattern length in bytes:
+                vm->sr.n = vm->m.ptr[vm->m.off++];
+                // maximum number of matches:
+                vm->sr.m = vm->m.ptr[vm->m.off++];
+                // translate 0 -> 256:
+                if (vm->sr.m == 0) { vm->sr.m = 256; }
+
+                if (vm->sr.n == 0 || vm->sr.n > IOVM1_SEARCH_MAX_PATTERN) {
+                    vm->e = IOVM1_ERROR_OUT_OF_RANGE;
+                    iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                    iovm1_send_end(vm);
+                    return vm->e;
+                }
+
+                // pattern and optional mask:
+                vm->sr.p = vm->m.off;
+                vm->sr.k = 0;
+                vm->next_off += vm->sr.n;
+                if (((x >> 2) & 1) != 0) {
+                    vm->sr.k = vm->next_off;
+                    vm->next_off += vm->sr.n;
+                }
+
+                // perform entire search:
+                iovm1_set_state(vm, IOVM1_STATE_SEARCH);
+                vm->sr.os = IOVM1_OPSTATE_INIT;
+                goto do_search;
+            }
             case IOVM1_OPCODE_WAIT_UNTIL: {
                 vm->next_off = vm->m.off + 6;
 
@@ -233,7 +1065,10 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
                 vm->wa.k  = vm->m.ptr[vm->m.off++];
 
                 // perform loop to wait until (comparison byte & mask) successfully compares to value:
-                vm->s = IOVM1_STATE_WAIT;
+#ifdef IOVM1_USE_SUMMARY
+                vm->sum.t_wait_start = host_clock_now(vm);
+#endif
+                iovm1_set_state(vm, IOVM1_STATE_WAIT);
                 vm->wa.os = IOVM1_OPSTATE_INIT;
                 goto do_wait;
             }
@@ -258,31 +1093,189 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
                 uint8_t b;
 
                 // try to read a byte from memory chip:
-                if ((vm->e = host_memory_try_read_byte(vm, c, a, &b)) != IOVM1_SUCCESS) {
-                    vm->s = IOVM1_STATE_ERRORED;
-                    host_send_end(vm);
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_TRY_READ_BYTE);
+                vm->e = host_memory_try_read_byte(vm, c, a, &b);
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_TRY_READ_BYTE);
+                if (vm->e != IOVM1_SUCCESS) {
+                    iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                    iovm1_send_end(vm);
                     return vm->e;
                 }
 
                 // test comparison byte against mask and value:
-                if (!iovm1_memory_cmp(q, b & k, v)) {
+                if (!iovm1_memory_test(q, b, v, k)) {
                     // abort if false; send an abort message back to the client:
-                    vm->s = IOVM1_STATE_ERRORED;
+                    iovm1_set_state(vm, IOVM1_STATE_ERRORED);
                     vm->e = IOVM1_ERROR_ABORTED;
-                    host_send_end(vm);
+                    iovm1_send_end(vm);
 
                     return vm->e;
                 }
 
                 // do not abort if true:
+                IOVM1_HOOK_INST(vm, IOVM1_HOOK_INST_END);
+                vm->e = IOVM1_SUCCESS;
+                return vm->e;
+            }
+            case IOVM1_OPCODE_RMW: {
+                vm->next_off = vm->m.off + 6;
+
+                enum iovm1_alu_operator q = IOVM1_INST_ALU_OPERATOR(x);
+                // reject undefined operators before touching the host:
+                if (q > IOVM1_ALU_ADD) {
+                    vm->e = IOVM1_ERROR_UNKNOWN_OPCODE;
+                    iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                    iovm1_send_end(vm);
+                    return vm->e;
+                }
+
+                // memory chip identifier:
+                enum iovm1_memory_chip c = (enum iovm1_memory_chip)vm->m.ptr[vm->m.off++];
+                // 24-bit address:
+                uint24_t lo = (uint24_t)(vm->m.ptr[vm->m.off++]);
+                uint24_t hi = (uint24_t)(vm->m.ptr[vm->m.off++]) << 8;
+                uint24_t bk = (uint24_t)(vm->m.ptr[vm->m.off++]) << 16;
+                uint24_t a = bk | hi | lo;
+
+                // operand byte
+                uint8_t v  = vm->m.ptr[vm->m.off++];
+                // write mask
+                uint8_t k  = vm->m.ptr[vm->m.off++];
+
+                uint8_t b, n = 0;
+
+                // try to read a byte from memory chip:
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_TRY_READ_BYTE);
+                vm->e = host_memory_try_read_byte(vm, c, a, &b);
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_TRY_READ_BYTE);
+                if (vm->e != IOVM1_SUCCESS) {
+                    iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                    iovm1_send_end(vm);
+                    return vm->e;
+                }
+
+                // modify:
+                iovm1_memory_alu(q, b, v, &n);
+                // only modify the bits selected by the mask:
+                b = (b & ~k) | (n & k);
+
+                // write back:
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_TRY_WRITE_BYTE);
+                vm->e = host_memory_try_write_byte(vm, c, a, b);
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_TRY_WRITE_BYTE);
+                if (vm->e != IOVM1_SUCCESS) {
+                    iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                    iovm1_send_end(vm);
+                    return vm->e;
+                }
+
+                IOVM1_HOOK_INST(vm, IOVM1_HOOK_INST_END);
+                vm->e = IOVM1_SUCCESS;
+                return vm->e;
+            }
+            case IOVM1_OPCODE_CAS: {
+                vm->next_off = vm->m.off + 7;
+
+                enum iovm1_cmp_operator q = IOVM1_INST_CMP_OPERATOR(x);
+
+                // memory chip identifier:
+                enum iovm1_memory_chip c = (enum iovm1_memory_chip)vm->m.ptr[vm->m.off++];
+                // 24-bit address:
+                uint24_t lo = (uint24_t)(vm->m.ptr[vm->m.off++]);
+                uint24_t hi = (uint24_t)(vm->m.ptr[vm->m.off++]) << 8;
+                uint24_t bk = (uint24_t)(vm->m.ptr[vm->m.off++]) << 16;
+                uint24_t a = bk | hi | lo;
+
+                // comparison byte
+                uint8_t v  = vm->m.ptr[vm->m.off++];
+                // comparison mask
+                uint8_t k  = vm->m.ptr[vm->m.off++];
+                // new value
+                uint8_t n  = vm->m.ptr[vm->m.off++];
+
+                uint8_t b;
+
+                // try to read a byte from memory chip:
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_TRY_READ_BYTE);
+                vm->e = host_memory_try_read_byte(vm, c, a, &b);
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_TRY_READ_BYTE);
+                if (vm->e != IOVM1_SUCCESS) {
+                    iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                    iovm1_send_end(vm);
+                    return vm->e;
+                }
+
+                // test comparison byte against mask and value:
+                if (!iovm1_memory_test(q, b, v, k)) {
+                    // abort if false; send an abort message back to the client:
+                    iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                    vm->e = IOVM1_ERROR_ABORTED;
+                    iovm1_send_end(vm);
+
+                    return vm->e;
+                }
+
+                // swap in new value if true:
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_TRY_WRITE_BYTE);
+                vm->e = host_memory_try_write_byte(vm, c, a, n);
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_TRY_WRITE_BYTE);
+                if (vm->e != IOVM1_SUCCESS) {
+                    iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                    iovm1_send_end(vm);
+                    return vm->e;
+                }
+
+                IOVM1_HOOK_INST(vm, IOVM1_HOOK_INST_END);
+                vm->e = IOVM1_SUCCESS;
+                return vm->e;
+            }
+            case IOVM1_OPCODE_SKIP_UNLESS: {
+                vm->next_off = vm->m.off + 8;
+
+                enum iovm1_cmp_operator q = IOVM1_INST_CMP_OPERATOR(x);
+
+                // memory chip identifier:
+                enum iovm1_memory_chip c = (enum iovm1_memory_chip)vm->m.ptr[vm->m.off++];
+                // 24-bit address:
+                uint24_t lo = (uint24_t)(vm->m.ptr[vm->m.off++]);
+                uint24_t hi = (uint24_t)(vm->m.ptr[vm->m.off++]) << 8;
+                uint24_t bk = (uint24_t)(vm->m.ptr[vm->m.off++]) << 16;
+                uint24_t a = bk | hi | lo;
+
+                // comparison byte
+                uint8_t v  = vm->m.ptr[vm->m.off++];
+                // comparison mask
+                uint8_t k  = vm->m.ptr[vm->m.off++];
+                // 16-bit forward skip distance in bytes
+                uint32_t d = (uint32_t)(vm->m.ptr[vm->m.off++]);
+                d |= (uint32_t)(vm->m.ptr[vm->m.off++]) << 8;
+
+                uint8_t b;
+
+                // try to read a byte from memory chip:
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_TRY_READ_BYTE);
+                vm->e = host_memory_try_read_byte(vm, c, a, &b);
+                IOVM1_HOOK(vm, IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_TRY_READ_BYTE);
+                if (vm->e != IOVM1_SUCCESS) {
+                    iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                    iovm1_send_end(vm);
+                    return vm->e;
+                }
+
+                // test comparison byte against mask and value; skip forward if false:
+                if (!iovm1_memory_test(q, b, v, k)) {
+                    vm->next_off += d;
+                }
+
+                IOVM1_HOOK_INST(vm, IOVM1_HOOK_INST_END);
                 vm->e = IOVM1_SUCCESS;
                 return vm->e;
             }
             default:
                 // unknown opcode:
                 vm->e = IOVM1_ERROR_UNKNOWN_OPCODE;
-                vm->s = IOVM1_STATE_ERRORED;
-                host_send_end(vm);
+                iovm1_set_state(vm, IOVM1_STATE_ERRORED);
+                iovm1_send_end(vm);
                 return vm->e;
         }
     }
@@ -291,6 +1284,163 @@ enum iovm1_error iovm1_exec(struct iovm1_t *vm) {
     return vm->e;
 }
 
+int iovm1_memory_mismatch(const uint8_t *expected, const uint8_t *actual, int l, uint8_t *bitmap) {
+    int n = 0;
+    int i = 0;
+
+    memset(bitmap, 0, 32);
+
+#if defined(__SSE2__)
+    // 16 bytes at a time; movemask bit order matches the bitmap's LSB-first order:
+    for (; i + 16 <= l; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(expected + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(actual + i));
+        unsigned d = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFF;
+        bitmap[(i >> 3) + 0] = (uint8_t)d;
+        bitmap[(i >> 3) + 1] = (uint8_t)(d >> 8);
+        n += __builtin_popcount(d);
+    }
+#else
+    // 8 bytes at a time; skip over fully matching words:
+    for (; i + 8 <= l; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, expected + i, 8);
+        memcpy(&b, actual + i, 8);
+        if (a == b) {
+            continue;
+        }
+        for (int j = i; j < i + 8; j++) {
+            uint8_t d = expected[j] != actual[j];
+            bitmap[j >> 3] |= d << (j & 7);
+            n += d;
+        }
+    }
+#endif
+
+    for (; i < l; i++) {
+        uint8_t d = expected[i] != actual[i];
+        bitmap[i >> 3] |= d << (i & 7);
+        n += d;
+    }
+
+    return n;
+}
+
+int iovm1_memory_first_mismatch(const uint8_t *expected, const uint8_t *actual, int l) {
+    int i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 16 <= l; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(expected + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(actual + i));
+        unsigned d = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFF;
+        if (d) {
+            return i + __builtin_ctz(d);
+        }
+    }
+#else
+    for (; i + 8 <= l; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, expected + i, 8);
+        memcpy(&b, actual + i, 8);
+        if (a != b) {
+            break;
+        }
+    }
+#endif
+
+    for (; i < l; i++) {
+        if (expected[i] != actual[i]) {
+            return i;
+        }
+    }
+
+    return l;
+}
+
+// finds the first candidate offset in `h[0..hl)` where `(h[i] & k) == b`:
+static uint32_t iovm1_memory_search_anchor(const uint8_t *h, uint32_t hl, uint8_t b, uint8_t k) {
+    uint32_t i = 0;
+
+    if (k == 0xFF) {
+        // libc memchr is vectorized:
+        const uint8_t *f = (const uint8_t *)memchr(h, b, hl);
+        return f ? (uint32_t)(f - h) : hl;
+    }
+
+#if defined(__SSE2__)
+    __m128i vb = _mm_set1_epi8((char)b);
+    __m128i vk = _mm_set1_epi8((char)k);
+    for (; i + 16 <= hl; i += 16) {
+        __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(h + i)), vk);
+        unsigned d = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vb));
+        if (d) {
+            return i + __builtin_ctz(d);
+        }
+    }
+#endif
+
+    for (; i < hl; i++) {
+        if ((h[i] & k) == b) {
+            return i;
+        }
+    }
+
+    return hl;
+}
+
+uint32_t iovm1_memory_search(const uint8_t *h, uint32_t hl, const uint8_t *pattern, const uint8_t *mask, int n) {
+    uint8_t pm[IOVM1_SEARCH_MAX_PATTERN];
+    uint8_t km[IOVM1_SEARCH_MAX_PATTERN];
+    int j = -1;
+
+    if ((uint32_t)n > hl) {
+        return hl;
+    }
+
+    // pre-mask the pattern and pick an anchor byte, preferring one with a full mask so memchr can be used:
+    for (int i = 0; i < n; i++) {
+        km[i] = mask ? mask[i] : 0xFF;
+        pm[i] = pattern[i] & km[i];
+        if (km[i] == 0xFF && (j < 0 || km[j] != 0xFF)) {
+            j = i;
+        } else if (km[i] != 0 && j < 0) {
+            j = i;
+        }
+    }
+    if (j < 0) {
+        // fully masked out pattern matches anywhere:
+        return 0;
+    }
+
+    // scan for anchor candidates then verify the whole pattern:
+    uint32_t end = hl - (uint32_t)n + 1;
+    for (uint32_t i = 0; i < end; i++) {
+        uint32_t f = iovm1_memory_search_anchor(h + i + j, end - i, pm[j], km[j]);
+        if (f == end - i) {
+            break;
+        }
+        i += f;
+
+        if (!mask) {
+            if (memcmp(h + i, pm, n) == 0) {
+                return i;
+            }
+            continue;
+        }
+
+        int t = 0;
+        while (t < n && (h[i + t] & km[t]) == pm[t]) {
+            t++;
+        }
+        if (t == n) {
+            return i;
+        }
+    }
+
+    return hl;
+}
+
 #ifdef __cplusplus
 }
 #endif
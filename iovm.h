@@ -9,8 +9,8 @@ extern "C" {
     iovm.h: low-latency embedded I/O virtual machine execution engine
 
     features / restrictions:
-        * max of 4 instruction opcodes
-        * no branching instructions
+        * max of 32 instruction opcodes
+        * no branching instructions; SKIP_UNLESS may only skip forward so every program terminates
         * no state carried across instructions
 
     host MUST implement host_* named functions.
@@ -33,19 +33,105 @@ memory:
     NOTE: entire program MUST be buffered into memory before execution starts to avoid timing delays between and
     during instruction execution.
 
+verification:
+    iovm1_verify() walks a loaded program once and checks that every instruction has a defined opcode and lies
+    entirely within program memory, and that every SKIP_UNLESS target lands exactly on an instruction boundary or on
+    the end of the program. iovm1_exec() does not repeat these checks so hosts accepting programs from untrusted
+    clients SHOULD call iovm1_verify() after iovm1_load(). on failure `vm->p` holds the offending instruction offset.
+
+summary:
+    when compiled with IOVM1_USE_SUMMARY, iovm1_exec() keeps `vm->sum` up to date with the program's start and end
+    times and frame counters, the number of instructions executed and the time spent in WAIT_UNTIL. times are in
+    whatever units host_clock_now() returns. the summary is final by the time host_send_end() is called, which can
+    then use iovm1_summary_pack() to append it to the end message:
+
+        offset  size  field
+        0       1     enum iovm1_error e
+        1       3     failing instruction offset `vm->p`, or program length on success
+        4       8     host clock at program start
+        12      4     host clock elapsed from start to end, saturated
+        16      4     host clock elapsed in WAIT_UNTIL, saturated
+        20      4     frame counter at program start
+        24      4     frame counter at program end
+        28      4     instructions executed
+
+    all fields are little-endian. hosts may also prefix each READ reply with iovm1_summary_pack_read_header() to
+    timestamp the data:
+
+        offset  size  field
+        0       8     host clock
+        8       4     frame counter
+
+hooks:
+    when compiled with IOVM1_USE_HOOKS, iovm1_exec() calls host_hook() at each of the points in `enum iovm1_hook`.
+    without IOVM1_USE_HOOKS the hook points compile to nothing. iovm_prof.h provides a ready-made host_hook()
+    consumer that collects per-opcode counts and cycles, per-host-call counts and cycles and per-chip byte counts.
+
+chip table:
+    when compiled with IOVM1_USE_CHIP_TABLE, hosts may register a table describing each memory chip with
+    iovm1_set_chips(). iovm1_exec() then validates the whole `[a, a+l)` range of every memory access once when the
+    instruction is decoded and fails with IOVM1_ERROR_MEMORY_CHIP_* before calling any host function, so host state
+    machines can run without per-byte checks. iovm1_verify() performs the same checks for the whole program up front;
+    a program verified against the registered table is not checked again at decode. chips with
+    IOVM1_CHIP_WRAP mirror every address into their size, so only their access rights are checked. without a
+    registered table validation is left to the host.
+
+access control:
+    when compiled with IOVM1_USE_ACL, hosts relaying programs from several clients may attach per-chip read and
+    write page bitmaps to each VM with iovm1_set_acl(). accesses are checked at the same point as the chip table:
+    once per instruction at decode, or for the whole program by iovm1_verify(), with a mask test on at most two
+    bitmap words for any range up to 16 KiB. denied accesses fail with IOVM1_ERROR_ACCESS_DENIED before any host
+    function is called. RMW, CAS and WRITE_VERIFY need both read and write permission.
+
+checkpoint:
+    when compiled with IOVM1_USE_CHECKPOINT, iovm1_checkpoint() serializes the execution context of a VM between
+    iovm1_exec() calls into IOVM1_CHECKPOINT_SIZE bytes, and iovm1_restore() resumes a VM with the same program
+    loaded at the exact instruction, so a relay restart or reconnect need not rerun the program from scratch and VMs
+    can move between worker threads. an in-progress READ, WRITE, WAIT_UNTIL, COMPARE or SEARCH resumes with its
+    remaining address and length: a host that has already transferred part of an access advances `a` and `l`
+    before the checkpoint. the restored context is validated against the loaded program, whose instructions are
+    walked from the start so `p` and `next_off` must fall on instruction boundaries, and the VM's chip table and
+    ACL. the execution summary restarts at the restore. multi-byte fields are little-endian:
+
+        offset  size  field
+        0       4     "IVC1"
+        4       8     iovm1_program_hash() of the program
+        12      4     program length
+        16      1     state
+        17      1     error
+        18      2     reserved
+        20      4     `p`
+        24      4     `next_off`
+        28      1     opstate                 instruction state; zero outside READ..SEARCH
+        29      1     memory chip
+        30      3     address
+        33      1     raw length (READ, WRITE, COMPARE); comparison byte (WAIT_UNTIL); pattern length (SEARCH)
+        34      1     comparison mask (WAIT_UNTIL); reply mode (COMPARE)
+        35      1     comparison operator (WAIT_UNTIL)
+        36      4     remaining length
+        40      4     data or pattern offset
+        44      4     pattern mask offset (SEARCH)
+        48      2     maximum matches (SEARCH)
+        50      2     reserved
+
 instruction byte format:
 
-   765432 10
-  [?????? oo]
+   765 432 10
+  [OOO ??? oo]
 
-    o = opcode              [0..3]
+    o = opcode low bits     [0..3]
+    O = opcode high bits    [0..7]
     ? = varies by opcode
 
+    opcode = (O << 2) | o   [0..31]
+
+    the original four opcodes have O = 0 so programs written for them remain valid.
+
 opcodes (o):
 -----------------------
   0=READ:               reads bytes from memory chip
-     765432 10
-    [------ 00]
+     765 432 10
+    [000 --- 00]
 
         host functions used:
             enum iovm1_error host_memory_read_state_machine(struct iovm1_t *vm);
@@ -84,8 +170,8 @@ opcodes (o):
 
 -----------------------
   1=WRITE:              writes bytes to memory chip
-     765432 10
-    [------ 01]
+     765 432 10
+    [000 --- 01]
 
         host functions used:
             enum iovm1_error host_memory_write_state_machine(struct iovm1_t *vm);
@@ -126,7 +212,7 @@ opcodes (o):
 -----------------------
   2=WAIT_UNTIL:         waits until a byte read from a memory chip compares to a value -- for read/write timing purposes
      765 432 10
-    [--- qqq 10]
+    [000 qqq 10]
         q = comparison operator [0..7]
             0 =        EQ; equals
             1 =       NEQ; not equals
@@ -134,8 +220,12 @@ opcodes (o):
             3 =       NLT; not less than
             4 =        GT; greater than
             5 =       NGT; not greater than
-            6 = undefined; returns false
-            7 = undefined; returns false
+            6 =        IN; v <= b <= k; k is the upper bound and not applied as a mask
+            7 =       NIN; not IN
+
+        operators 0..5 compare `b & k` to `v`. common bit tests fit in a single instruction:
+            any bit of k set:   NEQ with v = 0
+            all bits of k set:  EQ  with v = k
 
         host interface functions used:
             enum iovm1_error host_memory_wait_state_machine(struct iovm1_t *vm)
@@ -158,9 +248,9 @@ opcodes (o):
         vm->wa.a  = m[p++]
         vm->wa.a |= m[p++] << 8
         vm->wa.a |= m[p++] << 16
-        // comparison byte
+        // comparison byte (lower bound for IN/NIN)
         vm->wa.v  = m[p++]
-        // comparison mask
+        // comparison mask (upper bound for IN/NIN)
         vm->wa.k  = m[p++]
 
         // trivial example wait command state machine:
@@ -177,7 +267,7 @@ opcodes (o):
 -----------------------
   3=ABORT_UNLESS:       reads a byte from a memory chip and compares to a value; if false, aborts program execution
      765 432 10
-    [--- qqq 11]
+    [000 qqq 11]
         q = comparison operator [0..7]
             0 =        EQ; equals
             1 =       NEQ; not equals
@@ -185,8 +275,12 @@ opcodes (o):
             3 =       NLT; not less than
             4 =        GT; greater than
             5 =       NGT; not greater than
-            6 = undefined; returns false
-            7 = undefined; returns false
+            6 =        IN; v <= b <= k; k is the upper bound and not applied as a mask
+            7 =       NIN; not IN
+
+        operators 0..5 compare `b & k` to `v`. common bit tests fit in a single instruction:
+            any bit of k set:   NEQ with v = 0
+            all bits of k set:  EQ  with v = k
 
         host interface functions used:
             enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t *b);
@@ -210,10 +304,261 @@ opcodes (o):
             host_memory_try_read_byte(vm, c, a, &b);
 
             // compare:
-            bool result = iovm1_memory_cmp(q, b & k, v);
+            bool result = iovm1_memory_test(q, b, v, k);
 
             // abort if result == false, else continue to next command
         }
+
+-----------------------
+  4=RMW:                reads a byte from a memory chip, modifies it and writes it back under a mask
+     765 432 10
+    [001 qqq 00]
+        q = ALU operator [0..7]
+            0 =        OR; b | v
+            1 =       AND; b & v
+            2 =       XOR; b ^ v
+            3 =       ADD; b + v (modulo 256)
+            4 = undefined; fails with IOVM1_ERROR_UNKNOWN_OPCODE
+            5 = undefined; fails with IOVM1_ERROR_UNKNOWN_OPCODE
+            6 = undefined; fails with IOVM1_ERROR_UNKNOWN_OPCODE
+            7 = undefined; fails with IOVM1_ERROR_UNKNOWN_OPCODE
+
+        host interface functions used:
+            enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t *b);
+            enum iovm1_error host_memory_try_write_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t b);
+
+        // memory chip identifier (0..255)
+        c  = m[p++]
+        // memory address in 24-bit little-endian byte order:
+        a  = m[p++]
+        a |= m[p++] << 8
+        a |= m[p++] << 16
+        // operand byte
+        v  = m[p++]
+        // write mask; only bits set in k are modified
+        k  = m[p++]
+
+        // RMW command is implemented entirely by iovm1_exec() with exactly one read and one write:
+        {
+            // fail with IOVM1_ERROR_UNKNOWN_OPCODE before any host access if q is undefined:
+            uint8_t b;
+
+            host_memory_try_read_byte(vm, c, a, &b);
+
+            uint8_t n;
+            iovm1_memory_alu(q, b, v, &n);
+            b = (b & ~k) | (n & k);
+
+            host_memory_try_write_byte(vm, c, a, b);
+        }
+
+-----------------------
+  5=CAS:                reads a byte from a memory chip and compares to a value; if true, writes a new value;
+                        if false, aborts program execution
+     765 432 10
+    [001 qqq 01]
+        q = comparison operator [0..7]; same as WAIT_UNTIL. EQ gives a classic compare-and-swap.
+
+        host interface functions used:
+            enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t *b);
+            enum iovm1_error host_memory_try_write_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t b);
+
+        // memory chip identifier (0..255)
+        c  = m[p++]
+        // memory address in 24-bit little-endian byte order:
+        a  = m[p++]
+        a |= m[p++] << 8
+        a |= m[p++] << 16
+        // comparison byte
+        v  = m[p++]
+        // comparison mask
+        k  = m[p++]
+        // new value to write
+        n  = m[p++]
+
+        // CAS command is implemented entirely by iovm1_exec() and not by a state machine:
+        {
+            uint8_t b;
+
+            host_memory_try_read_byte(vm, c, a, &b);
+
+            // abort if false; the failing instruction offset is left in vm->p for host_send_end():
+            if (!iovm1_memory_test(q, b, v, k))
+                abort;
+
+            host_memory_try_write_byte(vm, c, a, n);
+        }
+
+-----------------------
+  6=WRITE_VERIFY:       writes bytes to memory chip then reads them back and compares against the written data
+     765 432 10
+    [001 rrr 10]
+        r = reply mode [0..7]; same as COMPARE
+
+        host functions used:
+            enum iovm1_error host_memory_write_state_machine(struct iovm1_t *vm);
+            enum iovm1_error host_memory_verify_state_machine(struct iovm1_t *vm);
+
+        instruction format is identical to WRITE. the write is performed exactly as for WRITE via
+        host_memory_write_state_machine(). once the write completes, iovm1_exec() re-decodes the instruction into
+        `vm->vf` and calls host_memory_verify_state_machine() until it completes.
+
+        // verify state struct within struct iovm1_t:
+        struct {
+            // current state:
+            enum iovm1_opstate os;
+
+            enum iovm1_memory_chip c;
+            uint24_t a;
+            uint8_t l_raw;
+            int l;
+            // offset into vm->m.ptr of the expected data
+            uint32_t p;
+            // reply mode
+            enum iovm1_compare_reply r;
+        } vf;
+
+        // trivial example verify command state machine; replies with only a success flag or the mismatch details:
+        enum iovm1_error host_memory_verify_state_machine(struct iovm1_t *vm) {
+            uint8_t dm[256];
+            uint8_t bitmap[32];
+            for (int i = 0; i < vm->vf.l; i++)
+                dm[i] = read_memory_chip(vm->vf.c, vm->vf.a + i);
+            if (vm->vf.r == IOVM1_COMPARE_REPLY_FIRST_MISMATCH) {
+                int i = iovm1_memory_first_mismatch(&vm->m.ptr[vm->vf.p], dm, vm->vf.l);
+                if (i == vm->vf.l)
+                    send_verify_success();
+                else
+                    send_verify_first_mismatch(i);
+            } else if (iovm1_memory_mismatch(&vm->m.ptr[vm->vf.p], dm, vm->vf.l, bitmap) == 0)
+                send_verify_success();
+            else
+                send_verify_mismatch(bitmap);
+            vm->vf.os = IOVM1_OPSTATE_COMPLETED;
+            return IOVM1_SUCCESS;
+        }
+
+-----------------------
+  7=COMPARE:            compares bytes from memory chip against expected data carried inline in the program
+     765 432 10
+    [001 rrr 11]
+        r = reply mode [0..7]
+            0 = BITMAP;         reply with a success flag or a 256-bit mismatch bitmap
+            1 = FIRST_MISMATCH; reply with a success flag or the offset of the first mismatched byte
+            2..7 = undefined;   treated as BITMAP
+
+        host functions used:
+            enum iovm1_error host_memory_verify_state_machine(struct iovm1_t *vm);
+
+        instruction format is identical to WRITE; the data bytes are the expected chip contents. nothing is written;
+        iovm1_exec() decodes the instruction into `vm->vf` and calls host_memory_verify_state_machine() exactly as it
+        does for the readback half of WRITE_VERIFY.
+
+-----------------------
+  8=SEARCH:             searches a memory chip address range for a byte pattern and replies with matching addresses
+     765 432 10
+    [010 --k 00]
+        k = mask flag; if set, a mask byte follows the pattern for each pattern byte
+
+        host functions used:
+            enum iovm1_error host_memory_search_state_machine(struct iovm1_t *vm);
+
+        // search state struct within struct iovm1_t:
+        struct {
+            // current state:
+            enum iovm1_opstate os;
+
+            enum iovm1_memory_chip c;
+            uint24_t a;
+            // remaining length of range to search in bytes:
+            uint32_t l;
+            // pattern length in bytes (1..IOVM1_SEARCH_MAX_PATTERN):
+            uint8_t n;
+            // maximum number of matches to reply with (1..256):
+            int m;
+            // offset into vm->m.ptr of the pattern:
+            uint32_t p;
+            // offset into vm->m.ptr of the pattern mask, or 0 if unmasked:
+            uint32_t k;
+        } sr;
+
+        // memory chip identifier (0..255)
+        vm->sr.c  = m[p++]
+        // start memory address in 24-bit little-endian byte order:
+        vm->sr.a  = m[p++]
+        vm->sr.a |= m[p++] << 8
+        vm->sr.a |= m[p++] << 16
+        // length of range in bytes in 24-bit little-endian byte order (treat 0 as 16 MiB):
+        vm->sr.l  = m[p++]
+        vm->sr.l |= m[p++] << 8
+        vm->sr.l |= m[p++] << 16
+        // pattern length in bytes (1..IOVM1_SEARCH_MAX_PATTERN; else fails with IOVM1_ERROR_OUT_OF_RANGE)
+        vm->sr.n  = m[p++]
+        // maximum number of matches (treat 0 as 256, else 1..255)
+        vm->sr.m  = translate_zero_byte(m[p++])
+        // pattern bytes:
+        vm->sr.p  = p; p += vm->sr.n
+        // mask bytes, if k is set:
+        vm->sr.k  = k ? p : 0; p += k ? vm->sr.n : 0
+
+        a match is reported when the pattern lies entirely within the range. matches may overlap.
+
+        // trivial example search command state machine over a host chip buffer:
+        enum iovm1_error host_memory_search_state_machine(struct iovm1_t *vm) {
+            uint24_t found[256];
+            int count = 0;
+            const uint8_t *h = chip_buffer(vm->sr.c) + vm->sr.a;
+            uint32_t hl = vm->sr.l;
+            const uint8_t *k = vm->sr.k ? &vm->m.ptr[vm->sr.k] : 0;
+            while (count < vm->sr.m) {
+                uint32_t i = iovm1_memory_search(h, hl, &vm->m.ptr[vm->sr.p], k, vm->sr.n);
+                if (i == hl) break;
+                found[count++] = vm->sr.a + (h - chip_buffer(vm->sr.c)) + i;
+                h += i + 1; hl -= i + 1;
+            }
+            send_search_reply(count, found);
+            vm->sr.os = IOVM1_OPSTATE_COMPLETED;
+            return IOVM1_SUCCESS;
+        }
+
+-----------------------
+  9=SKIP_UNLESS:        reads a byte from a memory chip and compares to a value; if false, skips forward over the
+                        following instructions
+     765 432 10
+    [010 qqq 01]
+        q = comparison operator [0..7]; same as WAIT_UNTIL
+
+        host interface functions used:
+            enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t *b);
+
+        // memory chip identifier (0..255)
+        c  = m[p++]
+        // memory address in 24-bit little-endian byte order:
+        a  = m[p++]
+        a |= m[p++] << 8
+        a |= m[p++] << 16
+        // comparison byte
+        v  = m[p++]
+        // comparison mask
+        k  = m[p++]
+        // number of bytes of following instructions to skip in 16-bit little-endian byte order:
+        d  = m[p++]
+        d |= m[p++] << 8
+
+        // SKIP_UNLESS command is implemented entirely by iovm1_exec() and not by a state machine:
+        {
+            uint8_t b;
+
+            // try single byte read:
+            host_memory_try_read_byte(vm, c, a, &b);
+
+            // skip if result == false, else continue to next command
+            if (!iovm1_memory_test(q, b, v, k))
+                p += d;
+        }
+
+        the skip target is always computed relative to the end of the SKIP_UNLESS instruction so `d` is known when
+        the program is assembled and can be validated by iovm1_verify(); skips can never move backwards.
 */
 
 #include <stdint.h>
@@ -225,7 +570,13 @@ enum iovm1_opcode {
     IOVM1_OPCODE_READ,
     IOVM1_OPCODE_WRITE,
     IOVM1_OPCODE_WAIT_UNTIL,
-    IOVM1_OPCODE_ABORT_UNLESS
+    IOVM1_OPCODE_ABORT_UNLESS,
+    IOVM1_OPCODE_RMW,
+    IOVM1_OPCODE_CAS,
+    IOVM1_OPCODE_WRITE_VERIFY,
+    IOVM1_OPCODE_COMPARE,
+    IOVM1_OPCODE_SEARCH,
+    IOVM1_OPCODE_SKIP_UNLESS
 };
 
 enum iovm1_cmp_operator {
@@ -234,11 +585,33 @@ enum iovm1_cmp_operator {
     IOVM1_CMP_LT,
     IOVM1_CMP_NLT,
     IOVM1_CMP_GT,
-    IOVM1_CMP_NGT
+    IOVM1_CMP_NGT,
+    IOVM1_CMP_IN,
+    IOVM1_CMP_NIN
+};
+
+enum iovm1_compare_reply {
+    IOVM1_COMPARE_REPLY_BITMAP,
+    IOVM1_COMPARE_REPLY_FIRST_MISMATCH
+};
+
+enum iovm1_alu_operator {
+    IOVM1_ALU_OR,
+    IOVM1_ALU_AND,
+    IOVM1_ALU_XOR,
+    IOVM1_ALU_ADD
 };
 
-#define IOVM1_INST_OPCODE(x)        ((enum iovm1_opcode) ((x)&3))
+#define IOVM1_INST_OPCODE(x)        ((enum iovm1_opcode) (((x)&3) | (((x)>>3)&0x1C)))
 #define IOVM1_INST_CMP_OPERATOR(x)  ((enum iovm1_cmp_operator) (((x)>>2)&7))
+#define IOVM1_INST_ALU_OPERATOR(x)  ((enum iovm1_alu_operator) (((x)>>2)&7))
+#define IOVM1_INST_COMPARE_REPLY(x) ((enum iovm1_compare_reply) (((x)>>2)&7))
+
+#define IOVM1_MK(o, q) (          \
+        ((o)&3)         |         \
+        ((q)&7)<<2      |         \
+        ((o)&0x1C)<<3             \
+    )
 
 #define IOVM1_MK_WAIT_UNTIL(q) (  \
         IOVM1_OPCODE_WAIT_UNTIL | \
@@ -250,6 +623,21 @@ enum iovm1_cmp_operator {
         ((q)&7)<<2              \
     )
 
+#define IOVM1_MK_RMW(q) IOVM1_MK(IOVM1_OPCODE_RMW, q)
+
+#define IOVM1_MK_CAS(q) IOVM1_MK(IOVM1_OPCODE_CAS, q)
+
+#define IOVM1_MK_WRITE_VERIFY(r) IOVM1_MK(IOVM1_OPCODE_WRITE_VERIFY, r)
+
+#define IOVM1_MK_COMPARE(r) IOVM1_MK(IOVM1_OPCODE_COMPARE, r)
+
+#define IOVM1_MK_SEARCH(k) IOVM1_MK(IOVM1_OPCODE_SEARCH, (k)&1)
+
+#define IOVM1_MK_SKIP_UNLESS(q) IOVM1_MK(IOVM1_OPCODE_SKIP_UNLESS, q)
+
+// maximum SEARCH pattern length in bytes:
+#define IOVM1_SEARCH_MAX_PATTERN 16
+
 enum iovm1_memory_chip {
     MEM_SNES_WRAM,
     MEM_SNES_VRAM,
@@ -259,7 +647,48 @@ enum iovm1_memory_chip {
     MEM_SNES_2C00,
     MEM_SNES_ROM,
     MEM_SNES_SRAM,
+
+    // cartridge expansion chips, defined only by hosts whose cartridge has them:
+    MEM_SNES_SA1_IRAM,
+    MEM_SNES_SA1_BWRAM,
+    MEM_SNES_SFX_RAM,
+    MEM_MSU1_DATA,
+
+    // ids from here to 255 are left to hosts, e.g. for virtual regions exposing device status:
+    MEM_HOST_FIRST = 0x80,
+};
+
+#ifdef IOVM1_USE_CHIP_TABLE
+enum iovm1_chip_flags {
+    IOVM1_CHIP_READABLE = 1 << 0,
+    IOVM1_CHIP_WRITABLE = 1 << 1,
+    // addresses past `size` mirror back to the start:
+    IOVM1_CHIP_WRAP = 1 << 2,
+};
+
+struct iovm1_chip_t {
+    // size in bytes; 0 for an undefined chip
+    uint32_t size;
+    // enum iovm1_chip_flags
+    uint8_t flags;
+};
+#endif
+
+#ifdef IOVM1_USE_ACL
+// ACL granularity: 256-byte pages
+#define IOVM1_ACL_PAGE_SHIFT 8
+// number of pages resp. uint64_t bitmap words covering `size` bytes:
+#define IOVM1_ACL_PAGES(size) (((size) + (1UL << IOVM1_ACL_PAGE_SHIFT) - 1) >> IOVM1_ACL_PAGE_SHIFT)
+#define IOVM1_ACL_WORDS(size) ((IOVM1_ACL_PAGES(size) + 63) / 64)
+
+struct iovm1_acl_chip_t {
+    // one bit per page, LSB first, set where reads resp. writes are permitted; NULL denies all:
+    const uint64_t *r;
+    const uint64_t *w;
+    // number of pages the bitmaps cover; accesses past them are denied
+    uint32_t pages;
 };
+#endif
 
 enum iovm1_state {
     IOVM1_STATE_INIT,
@@ -269,6 +698,8 @@ enum iovm1_state {
     IOVM1_STATE_READ,
     IOVM1_STATE_WRITE,
     IOVM1_STATE_WAIT,
+    IOVM1_STATE_VERIFY,
+    IOVM1_STATE_SEARCH,
     IOVM1_STATE_ENDED,
     // any state after IOVM1_STATE_ENDED is considered errored:
     IOVM1_STATE_ERRORED,
@@ -285,6 +716,36 @@ enum iovm1_error {
     IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE,
     IOVM1_ERROR_MEMORY_CHIP_NOT_READABLE,
     IOVM1_ERROR_MEMORY_CHIP_NOT_WRITABLE,
+    // the VM's ACL does not permit the access:
+    IOVM1_ERROR_ACCESS_DENIED,
+    // a checkpoint was taken of a different program:
+    IOVM1_ERROR_PROGRAM_MISMATCH,
+};
+
+enum iovm1_hook {
+    // an instruction was decoded; arg = enum iovm1_opcode
+    IOVM1_HOOK_INST_START,
+    // an instruction completed or failed; arg = enum iovm1_opcode
+    IOVM1_HOOK_INST_END,
+    // `vm->s` changed; arg = previous enum iovm1_state
+    IOVM1_HOOK_STATE,
+    // about to call a host function; arg = enum iovm1_hook_host
+    IOVM1_HOOK_HOST_ENTER,
+    // returned from a host function; arg = enum iovm1_hook_host, `vm->e` holds its result
+    IOVM1_HOOK_HOST_EXIT,
+    // execution failed; arg = enum iovm1_error
+    IOVM1_HOOK_ERROR,
+};
+
+enum iovm1_hook_host {
+    IOVM1_HOOK_HOST_READ_STATE_MACHINE,
+    IOVM1_HOOK_HOST_WRITE_STATE_MACHINE,
+    IOVM1_HOOK_HOST_WAIT_STATE_MACHINE,
+    IOVM1_HOOK_HOST_VERIFY_STATE_MACHINE,
+    IOVM1_HOOK_HOST_SEARCH_STATE_MACHINE,
+    IOVM1_HOOK_HOST_TRY_READ_BYTE,
+    IOVM1_HOOK_HOST_TRY_WRITE_BYTE,
+    IOVM1_HOOK_HOST_COUNT
 };
 
 enum iovm1_opstate {
@@ -303,13 +764,31 @@ extern enum iovm1_error host_memory_read_state_machine(struct iovm1_t *vm);
 extern enum iovm1_error host_memory_write_state_machine(struct iovm1_t *vm);
 // advance memory-wait state machine, use `vm->wa` for tracking state, use `iovm1_memory_wait_test_byte` for comparison func
 extern enum iovm1_error host_memory_wait_state_machine(struct iovm1_t *vm);
+// advance memory-search state machine, use `vm->sr` for tracking state, use `iovm1_memory_search` for matching
+extern enum iovm1_error host_memory_search_state_machine(struct iovm1_t *vm);
+// advance memory-verify state machine, use `vm->vf` for tracking state, use `iovm1_memory_mismatch` for comparison func
+extern enum iovm1_error host_memory_verify_state_machine(struct iovm1_t *vm);
 
 // try to read a byte from a memory chip, return byte in `*b` if successful
 extern enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t *b);
+// try to write a byte `b` to a memory chip
+extern enum iovm1_error host_memory_try_write_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t b);
 
 // send a program-end message to the client
 extern void host_send_end(struct iovm1_t *vm);
 
+#ifdef IOVM1_USE_HOOKS
+// observe an execution event; see `enum iovm1_hook` for the meaning of `arg`
+extern void host_hook(struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg);
+#endif
+
+#ifdef IOVM1_USE_SUMMARY
+// read a monotonic host clock, e.g. in microseconds
+extern uint64_t host_clock_now(struct iovm1_t *vm);
+// read the current video frame counter
+extern uint32_t host_frame_counter(struct iovm1_t *vm);
+#endif
+
 // iovm1_t definition:
 
 struct iovm1_t {
@@ -328,6 +807,37 @@ struct iovm1_t {
     void *userdata;
 #endif
 
+#ifdef IOVM1_USE_CHIP_TABLE
+    // chip table indexed by `enum iovm1_memory_chip`, or NULL:
+    const struct iovm1_chip_t *chips;
+    uint32_t chips_len;
+#endif
+#ifdef IOVM1_USE_ACL
+    // access control indexed by `enum iovm1_memory_chip`, or NULL:
+    const struct iovm1_acl_chip_t *acl;
+    uint32_t acl_len;
+#endif
+#if defined(IOVM1_USE_CHIP_TABLE) || defined(IOVM1_USE_ACL)
+    // program passed iovm1_verify() against the registered chip table and ACL:
+    bool access_verified;
+#endif
+
+#ifdef IOVM1_USE_SUMMARY
+    // summary of the current or last program execution:
+    struct {
+        uint64_t t_start;
+        uint64_t t_end;
+        // total time spent in WAIT_UNTIL:
+        uint64_t t_wait;
+        // start time of the current WAIT_UNTIL:
+        uint64_t t_wait_start;
+        uint32_t frame_start;
+        uint32_t frame_end;
+        // number of instructions executed:
+        uint32_t insns;
+    } sum;
+#endif
+
     // offset of current executing opcode:
     uint32_t p;
 
@@ -363,6 +873,34 @@ struct iovm1_t {
             uint8_t k;
             enum iovm1_cmp_operator q;
         } wa;
+        // verify
+        struct {
+            enum iovm1_opstate os;
+            enum iovm1_memory_chip c;
+            uint24_t a;
+            uint8_t l_raw;
+            int l;
+            // offset into vm->m.ptr of the expected data
+            uint32_t p;
+            // reply mode
+            enum iovm1_compare_reply r;
+        } vf;
+        // search
+        struct {
+            enum iovm1_opstate os;
+            enum iovm1_memory_chip c;
+            uint24_t a;
+            // remaining length of range to search in bytes
+            uint32_t l;
+            // pattern length in bytes
+            uint8_t n;
+            // maximum number of matches
+            int m;
+            // offset into vm->m.ptr of the pattern
+            uint32_t p;
+            // offset into vm->m.ptr of the pattern mask, or 0 if unmasked
+            uint32_t k;
+        } sr;
     };
 };
 
@@ -375,8 +913,53 @@ void iovm1_set_userdata(struct iovm1_t *vm, void *userdata);
 void *iovm1_get_userdata(struct iovm1_t *vm);
 #endif
 
+#ifdef IOVM1_USE_CHIP_TABLE
+// registers `len` chip descriptions indexed by `enum iovm1_memory_chip`; NULL disables validation. the table is not
+// copied and must outlive the VM
+void iovm1_set_chips(struct iovm1_t *vm, const struct iovm1_chip_t *chips, uint32_t len);
+#endif
+
+#ifdef IOVM1_USE_ACL
+// registers `len` per-chip ACLs indexed by `enum iovm1_memory_chip`; chips past `len` are denied. NULL disables
+// access control. the ACLs are not copied and must outlive the VM
+void iovm1_set_acl(struct iovm1_t *vm, const struct iovm1_acl_chip_t *acl, uint32_t len);
+
+// permits resp. denies every page overlapping `[a, a+l)` in a bitmap of `pages` pages
+void iovm1_acl_grant(uint64_t *bits, uint32_t pages, uint24_t a, uint32_t l);
+void iovm1_acl_revoke(uint64_t *bits, uint32_t pages, uint24_t a, uint32_t l);
+
+// true if every page overlapping `[a, a+l)` is set in a bitmap of `pages` pages
+bool iovm1_acl_test(const uint64_t *bits, uint32_t pages, uint24_t a, uint32_t l);
+#endif
+
+#ifdef IOVM1_USE_SUMMARY
+#define IOVM1_SUMMARY_SIZE 32
+#define IOVM1_SUMMARY_READ_HEADER_SIZE 12
+
+// packs the execution summary into `d[IOVM1_SUMMARY_SIZE]`
+void iovm1_summary_pack(struct iovm1_t *vm, uint8_t *d);
+// packs the current host clock and frame counter into `d[IOVM1_SUMMARY_READ_HEADER_SIZE]`
+void iovm1_summary_pack_read_header(struct iovm1_t *vm, uint8_t *d);
+#endif
+
+#ifdef IOVM1_USE_CHECKPOINT
+#define IOVM1_CHECKPOINT_SIZE 52
+
+// 64-bit hash of program memory identifying the program a checkpoint belongs to
+uint64_t iovm1_program_hash(const uint8_t *proc, uint32_t len);
+
+// serializes the execution context into `d[IOVM1_CHECKPOINT_SIZE]`; call between iovm1_exec() calls
+void iovm1_checkpoint(struct iovm1_t *vm, uint8_t *d);
+
+// resumes a VM in LOADED state, with the same program loaded, at the checkpoint `d[IOVM1_CHECKPOINT_SIZE]`; fails
+// with IOVM1_ERROR_PROGRAM_MISMATCH for another program and IOVM1_ERROR_OUT_OF_RANGE for a malformed checkpoint
+enum iovm1_error iovm1_restore(struct iovm1_t *vm, const uint8_t *d);
+#endif
+
 enum iovm1_error iovm1_load(struct iovm1_t *vm, const uint8_t *proc, unsigned len);
 
+enum iovm1_error iovm1_verify(struct iovm1_t *vm);
+
 enum iovm1_error iovm1_exec_reset(struct iovm1_t *vm);
 
 static inline enum iovm1_state iovm1_get_exec_state(struct iovm1_t *vm) {
@@ -385,21 +968,52 @@ static inline enum iovm1_state iovm1_get_exec_state(struct iovm1_t *vm) {
 
 enum iovm1_error iovm1_exec(struct iovm1_t *vm);
 
+// compares `a` to `b` with operators EQ..NGT; IN and NIN need a second bound so return false here
 static inline bool iovm1_memory_cmp(enum iovm1_cmp_operator q, uint8_t a, uint8_t b) {
+    // bit `o` set if operator is true for outcome o = 0 (a < b), 1 (a == b), 2 (a > b):
+    static const uint8_t t[8] = { 0x2, 0x5, 0x1, 0x6, 0x4, 0x3, 0x0, 0x0 };
+    unsigned o = (a >= b) + (a > b);
+    return (t[q & 7] >> o) & 1;
+}
+
+// tests byte `x` against comparison byte `v` and mask `k` with any operator; for IN/NIN `v` and `k` are the
+// inclusive lower and upper bounds and no mask is applied
+static inline bool iovm1_memory_test(enum iovm1_cmp_operator q, uint8_t x, uint8_t v, uint8_t k) {
+    // bit `3*lo + hi` set if operator is true for outcomes lo of x vs. v and hi of x vs. k, each
+    // 0 (less), 1 (equal), 2 (greater):
+    static const uint16_t t[8] = { 0x038, 0x1C7, 0x007, 0x1F8, 0x1C0, 0x03F, 0x0D8, 0x127 };
+    uint8_t a = x & ((q & 6) == 6 ? 0xFF : k);
+    unsigned lo = (a >= v) + (a > v);
+    unsigned hi = (a >= k) + (a > k);
+    return (t[q & 7] >> (lo * 3 + hi)) & 1;
+}
+
+// applies the ALU operator `q` to byte `b` and operand `v`; returns false if `q` is undefined
+static inline bool iovm1_memory_alu(enum iovm1_alu_operator q, uint8_t b, uint8_t v, uint8_t *n) {
     switch (q) {
-        case IOVM1_CMP_EQ: return a == b;
-        case IOVM1_CMP_NEQ: return a != b;
-        case IOVM1_CMP_LT: return a < b;
-        case IOVM1_CMP_NLT: return a >= b;
-        case IOVM1_CMP_GT: return a > b;
-        case IOVM1_CMP_NGT: return a <= b;
+        case IOVM1_ALU_OR: *n = b | v; return true;
+        case IOVM1_ALU_AND: *n = b & v; return true;
+        case IOVM1_ALU_XOR: *n = b ^ v; return true;
+        case IOVM1_ALU_ADD: *n = (uint8_t)(b + v); return true;
         default: return false;
     }
 }
 
+// compares `l` bytes (1..256) of `expected` against `actual`; sets bit `i` of `bitmap` (32 bytes, LSB first) for each
+// mismatched byte `i`, clears all other bits and returns the number of mismatched bytes
+int iovm1_memory_mismatch(const uint8_t *expected, const uint8_t *actual, int l, uint8_t *bitmap);
+
+// compares `l` bytes (1..256) of `expected` against `actual`; returns the offset of the first mismatched byte or `l`
+// if all bytes match
+int iovm1_memory_first_mismatch(const uint8_t *expected, const uint8_t *actual, int l);
+
+// finds the first offset in `h` of `n` bytes (1..IOVM1_SEARCH_MAX_PATTERN) matching `pattern` where each byte is
+// compared under `mask` if non-NULL; returns `hl` if no match lies entirely within `h`
+uint32_t iovm1_memory_search(const uint8_t *h, uint32_t hl, const uint8_t *pattern, const uint8_t *mask, int n);
+
 // tests the read byte `b` with the current wait command's comparison function and bit mask
 static inline bool iovm1_memory_wait_test_byte(struct iovm1_t *vm, uint8_t a) {
-    return iovm1_memory_cmp(vm->wa.q, a & vm->wa.k, vm->wa.v);
+    return iovm1_memory_test(vm->wa.q, a, vm->wa.v, vm->wa.k);
 }
 
 #ifdef __cplusplus
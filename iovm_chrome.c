@@ -0,0 +1,124 @@
+#include <string.h>
+
+#include "iovm_chrome.h"
+#include "iovm_prof.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static const char *state_names[] = {
+    [IOVM1_STATE_INIT] = "INIT",
+    [IOVM1_STATE_LOADED] = "LOADED",
+    [IOVM1_STATE_RESET] = "RESET",
+    [IOVM1_STATE_EXECUTE_NEXT] = "EXECUTE_NEXT",
+    [IOVM1_STATE_READ] = "READ",
+    [IOVM1_STATE_WRITE] = "WRITE",
+    [IOVM1_STATE_WAIT] = "WAIT",
+    [IOVM1_STATE_VERIFY] = "VERIFY",
+    [IOVM1_STATE_SEARCH] = "SEARCH",
+    [IOVM1_STATE_ENDED] = "ENDED",
+    [IOVM1_STATE_ERRORED] = "ERRORED",
+};
+
+static const char *iovm1_chrome_state_name(uint32_t s) {
+    if (s >= sizeof(state_names) / sizeof(state_names[0]) || !state_names[s]) {
+        return "UNKNOWN";
+    }
+    return state_names[s];
+}
+
+// starts an event object with the fields common to all events:
+static void iovm1_chrome_event(struct iovm1_chrome_t *c, const struct iovm1_trace_rec_t *r, char ph) {
+    uint64_t dt = r->t - c->t0;
+
+    fprintf(c->f, "%s\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03u",
+        c->n++ ? "," : "",
+        ph,
+        r->vm,
+        (unsigned long long)(dt / 1000),
+        (unsigned)(dt % 1000));
+}
+
+int iovm1_chrome_begin(struct iovm1_chrome_t *c, FILE *f) {
+    if (!f) {
+        return -1;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->f = f;
+
+    return fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", f) < 0 ? -1 : 0;
+}
+
+void iovm1_chrome_record(struct iovm1_chrome_t *c, const struct iovm1_trace_rec_t *r) {
+    if (c->n == 0) {
+        c->t0 = r->t;
+    }
+
+    // name the VM's track on first sight:
+    if (!(c->named[r->vm >> 3] & (1 << (r->vm & 7)))) {
+        c->named[r->vm >> 3] |= 1 << (r->vm & 7);
+        iovm1_chrome_event(c, r, 'M');
+        fprintf(c->f, ",\"name\":\"thread_name\",\"args\":{\"name\":\"vm %u\"}}", r->vm);
+    }
+
+    switch (r->h) {
+        case IOVM1_HOOK_INST_START:
+            iovm1_chrome_event(c, r, 'B');
+            fprintf(c->f, ",\"cat\":\"inst\",\"name\":\"%s\",\"args\":{\"p\":%u,\"chip\":%u,\"addr\":\"%06x\"",
+                iovm1_opcode_name((enum iovm1_opcode)r->arg),
+                r->p,
+                r->c,
+                r->a);
+            // only transfer instructions carry a length byte:
+            switch (r->arg) {
+                case IOVM1_OPCODE_READ:
+                case IOVM1_OPCODE_WRITE:
+                case IOVM1_OPCODE_WRITE_VERIFY:
+                case IOVM1_OPCODE_COMPARE:
+                    fprintf(c->f, ",\"len\":%u", r->l ? r->l : 256);
+                    break;
+            }
+            fputs("}}", c->f);
+            break;
+        case IOVM1_HOOK_INST_END:
+            iovm1_chrome_event(c, r, 'E');
+            fprintf(c->f, ",\"args\":{\"e\":%u}}", r->e);
+            break;
+        case IOVM1_HOOK_HOST_ENTER:
+            iovm1_chrome_event(c, r, 'B');
+            fprintf(c->f, ",\"cat\":\"host\",\"name\":\"%s\"}",
+                iovm1_hook_host_name((enum iovm1_hook_host)r->arg));
+            break;
+        case IOVM1_HOOK_HOST_EXIT:
+            iovm1_chrome_event(c, r, 'E');
+            fprintf(c->f, ",\"args\":{\"e\":%u}}", r->e);
+            break;
+        case IOVM1_HOOK_STATE:
+            iovm1_chrome_event(c, r, 'i');
+            fprintf(c->f, ",\"s\":\"t\",\"cat\":\"state\",\"name\":\"%s\",\"args\":{\"from\":\"%s\"}}",
+                iovm1_chrome_state_name(r->s),
+                iovm1_chrome_state_name(r->arg));
+            break;
+        case IOVM1_HOOK_ERROR:
+            iovm1_chrome_event(c, r, 'i');
+            fprintf(c->f, ",\"s\":\"t\",\"cat\":\"error\",\"name\":\"error\",\"args\":{\"e\":%u,\"p\":%u}}",
+                r->arg,
+                r->p);
+            break;
+        default:
+            break;
+    }
+}
+
+int iovm1_chrome_end(struct iovm1_chrome_t *c) {
+    if (fputs("\n]}\n", c->f) < 0) {
+        return -1;
+    }
+    return fflush(c->f);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,59 @@
+#ifndef IOVM_CHROME_H
+#define IOVM_CHROME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    iovm_chrome.h: Chrome JSON trace export of iovm_trace records
+
+    converts `struct iovm1_trace_rec_t` records into the Chrome trace event format, loadable in chrome://tracing,
+    Perfetto (ui.perfetto.dev) and speedscope. each VM id becomes its own track; instructions and host function
+    calls become nested duration spans, state changes and errors become instant events. an instruction span covers
+    its whole wall time, so WAIT_UNTIL spans show the time spent waiting.
+
+        struct iovm1_chrome_t chrome;
+        struct iovm1_trace_rec_t recs[256];
+        uint32_t n;
+
+        iovm1_chrome_begin(&chrome, fopen("vm.json", "w"));
+        while ((n = iovm1_trace_drain(&trace, recs, 256)) > 0) {
+            for (uint32_t i = 0; i < n; i++) {
+                iovm1_chrome_record(&chrome, &recs[i]);
+            }
+        }
+        iovm1_chrome_end(&chrome);
+
+    `iovm_tracedump -c` converts a binary trace file.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "iovm.h"
+#include "iovm_trace.h"
+
+struct iovm1_chrome_t {
+    FILE *f;
+    // timestamp of the first record; all event timestamps are relative to it:
+    uint64_t t0;
+    uint64_t n;
+    // VM ids which already have a track name:
+    uint8_t named[65536 / 8];
+};
+
+// writes the JSON preamble
+int iovm1_chrome_begin(struct iovm1_chrome_t *c, FILE *f);
+
+// writes the events for one trace record
+void iovm1_chrome_record(struct iovm1_chrome_t *c, const struct iovm1_trace_rec_t *r);
+
+// terminates the JSON document and flushes the file
+int iovm1_chrome_end(struct iovm1_chrome_t *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //IOVM_CHROME_H
@@ -0,0 +1,196 @@
+#include <string.h>
+#include <time.h>
+
+#include "iovm_hist.h"
+#include "iovm_prof.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t iovm1_hist_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// values below IOVM1_HIST_SUB map 1:1; above, the top IOVM1_HIST_SUB_BITS+1 bits select the bucket:
+static inline uint32_t iovm1_hist_index(uint64_t v) {
+    if (v < IOVM1_HIST_SUB) {
+        return (uint32_t)v;
+    }
+
+    int shift = 63 - __builtin_clzll(v) - IOVM1_HIST_SUB_BITS;
+    return ((uint32_t)(shift + 1) << IOVM1_HIST_SUB_BITS) + (uint32_t)((v >> shift) - IOVM1_HIST_SUB);
+}
+
+// highest value which maps to bucket `i`:
+static inline uint64_t iovm1_hist_highest(uint32_t i) {
+    if (i < IOVM1_HIST_SUB) {
+        return i;
+    }
+
+    int shift = (int)(i >> IOVM1_HIST_SUB_BITS) - 1;
+    uint64_t lo = (uint64_t)(IOVM1_HIST_SUB + (i & (IOVM1_HIST_SUB - 1))) << shift;
+    return lo + ((1ULL << shift) - 1);
+}
+
+void iovm1_hist_init(struct iovm1_hist_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void iovm1_hist_record(struct iovm1_hist_t *h, uint64_t v) {
+    uint64_t x;
+
+    __atomic_fetch_add(&h->b[iovm1_hist_index(v)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, v, __ATOMIC_RELAXED);
+
+    x = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+    while (v < x && !__atomic_compare_exchange_n(&h->min, &x, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    x = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (v > x && !__atomic_compare_exchange_n(&h->max, &x, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+
+    // count last so a concurrent reader never sees more counted values than bucketed ones:
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELEASE);
+}
+
+uint64_t iovm1_hist_percentile(const struct iovm1_hist_t *h, double p) {
+    uint64_t count = __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+    uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    uint64_t target, n = 0;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    if (p <= 0) {
+        target = 1;
+    } else if (p >= 100) {
+        target = count;
+    } else {
+        target = (uint64_t)((p / 100.0) * (double)count + 0.999999);
+        if (target == 0) {
+            target = 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < IOVM1_HIST_BUCKETS; i++) {
+        n += __atomic_load_n(&h->b[i], __ATOMIC_RELAXED);
+        if (n >= target) {
+            uint64_t v = iovm1_hist_highest(i);
+            return v < max ? v : max;
+        }
+    }
+
+    return max;
+}
+
+uint64_t iovm1_hist_count_at_most(const struct iovm1_hist_t *h, uint64_t v) {
+    uint64_t n = 0;
+
+    for (uint32_t i = 0; i < IOVM1_HIST_BUCKETS && iovm1_hist_highest(i) <= v; i++) {
+        n += __atomic_load_n(&h->b[i], __ATOMIC_RELAXED);
+    }
+
+    return n;
+}
+
+void iovm1_hist_dump(const struct iovm1_hist_t *h, const char *name, FILE *f) {
+    uint64_t count = __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+
+    fprintf(f, "%-24s %10llu %10llu %12.1f %10llu %10llu %10llu %10llu %10llu\n",
+        name,
+        (unsigned long long)count,
+        (unsigned long long)(count ? h->min : 0),
+        count ? (double)h->sum / (double)count : 0.0,
+        (unsigned long long)iovm1_hist_percentile(h, 50),
+        (unsigned long long)iovm1_hist_percentile(h, 90),
+        (unsigned long long)iovm1_hist_percentile(h, 99),
+        (unsigned long long)iovm1_hist_percentile(h, 99.9),
+        (unsigned long long)h->max);
+}
+
+void iovm1_hists_init(struct iovm1_hists_t *hs) {
+    memset(hs, 0, sizeof(*hs));
+    iovm1_hist_init(&hs->wait);
+    for (int i = 0; i < IOVM1_HIST_OPCODES; i++) {
+        iovm1_hist_init(&hs->host[i]);
+    }
+    iovm1_hist_init(&hs->reentries);
+    iovm1_hist_init(&hs->program);
+    hs->last_host = IOVM1_HOOK_HOST_COUNT;
+}
+
+void iovm1_hists_hook(struct iovm1_hists_t *hs, struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg) {
+    uint64_t t = iovm1_hist_now();
+
+    switch (h) {
+        case IOVM1_HOOK_INST_START:
+            hs->inst_t0 = t;
+            hs->opcode = arg & (IOVM1_HIST_OPCODES - 1);
+            hs->last_host = IOVM1_HOOK_HOST_COUNT;
+            hs->host_calls = 0;
+            hs->continues = 0;
+            break;
+        case IOVM1_HOOK_INST_END:
+            if (arg == IOVM1_OPCODE_WAIT_UNTIL) {
+                iovm1_hist_record(&hs->wait, t - hs->inst_t0);
+            }
+            if (hs->host_calls) {
+                iovm1_hist_record(&hs->reentries, hs->continues);
+            }
+            break;
+        case IOVM1_HOOK_STATE:
+            if (vm->s == IOVM1_STATE_RESET) {
+                hs->program_t0 = t;
+            } else if (vm->s >= IOVM1_STATE_ENDED && hs->program_t0) {
+                iovm1_hist_record(&hs->program, t - hs->program_t0);
+                hs->program_t0 = 0;
+            }
+            break;
+        case IOVM1_HOOK_HOST_ENTER:
+            hs->host_t0 = t;
+            // only the state machines are called back with an in-progress operation:
+            if (arg <= IOVM1_HOOK_HOST_SEARCH_STATE_MACHINE) {
+                hs->host_calls++;
+                hs->continues += arg == hs->last_host;
+                hs->last_host = arg;
+            }
+            break;
+        case IOVM1_HOOK_HOST_EXIT:
+            iovm1_hist_record(&hs->host[hs->opcode], t - hs->host_t0);
+            break;
+        case IOVM1_HOOK_ERROR:
+            break;
+    }
+}
+
+void iovm1_hists_dump(const struct iovm1_hists_t *hs, FILE *f) {
+    char name[40];
+
+    fprintf(f, "%-24s %10s %10s %12s %10s %10s %10s %10s %10s\n",
+        "histogram", "count", "min", "mean", "p50", "p90", "p99", "p99.9", "max");
+    if (hs->program.count) {
+        iovm1_hist_dump(&hs->program, "program ns", f);
+    }
+    if (hs->wait.count) {
+        iovm1_hist_dump(&hs->wait, "wait ns", f);
+    }
+    for (int i = 0; i < IOVM1_HIST_OPCODES; i++) {
+        if (!hs->host[i].count) {
+            continue;
+        }
+        snprintf(name, sizeof(name), "host %s ns", iovm1_opcode_name((enum iovm1_opcode)i));
+        iovm1_hist_dump(&hs->host[i], name, f);
+    }
+    if (hs->reentries.count) {
+        iovm1_hist_dump(&hs->reentries, "reentries", f);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
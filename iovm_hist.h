@@ -0,0 +1,94 @@
+#ifndef IOVM_HIST_H
+#define IOVM_HIST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    iovm_hist.h: latency histograms for iovm1 execution hooks
+
+    requires iovm.c to be compiled with IOVM1_USE_HOOKS. log-bucketed histograms in the style of HdrHistogram: every
+    power-of-two range is split into 16 linear sub-buckets, so any recorded value is reported within 1/16 (6.25%)
+    of its true value across the full uint64_t range, in fixed memory. recording is a relaxed atomic increment and
+    never locks; percentile queries may run concurrently with recording from another thread.
+
+    `struct iovm1_hists_t` collects, in nanoseconds unless noted:
+        wait        WAIT_UNTIL instruction wall time, from decode to completion
+        host[o]     duration of every host function call made while executing opcode `o`
+        reentries   per instruction which called a host state machine: number of calls which continued an
+                    in-progress operation (os == IOVM1_OPSTATE_CONTINUE round trips); a count, not a duration
+        program     program wall time, from iovm1_exec_reset() to end or error
+
+    one collector per VM; the host forwards its host_hook() calls:
+
+        struct iovm1_hists_t hists;
+
+        void host_hook(struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg) {
+            iovm1_hists_hook(&hists, vm, h, arg);
+        }
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "iovm.h"
+
+// linear sub-buckets per power of two:
+#define IOVM1_HIST_SUB_BITS 4
+#define IOVM1_HIST_SUB (1 << IOVM1_HIST_SUB_BITS)
+#define IOVM1_HIST_BUCKETS ((64 - IOVM1_HIST_SUB_BITS + 1) * IOVM1_HIST_SUB)
+
+#define IOVM1_HIST_OPCODES 32
+
+struct iovm1_hist_t {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t b[IOVM1_HIST_BUCKETS];
+};
+
+struct iovm1_hists_t {
+    struct iovm1_hist_t wait;
+    struct iovm1_hist_t host[IOVM1_HIST_OPCODES];
+    struct iovm1_hist_t reentries;
+    struct iovm1_hist_t program;
+
+    // in-flight program, instruction and host call:
+    uint64_t program_t0;
+    uint64_t inst_t0;
+    uint64_t host_t0;
+    uint32_t opcode;
+    uint32_t last_host;
+    uint32_t host_calls;
+    uint32_t continues;
+};
+
+void iovm1_hist_init(struct iovm1_hist_t *h);
+
+void iovm1_hist_record(struct iovm1_hist_t *h, uint64_t v);
+
+// highest value equivalent to the `p`th percentile (0..100) of recorded values; 0 if empty
+uint64_t iovm1_hist_percentile(const struct iovm1_hist_t *h, double p);
+
+// number of recorded values in buckets lying entirely at or below `v`
+uint64_t iovm1_hist_count_at_most(const struct iovm1_hist_t *h, uint64_t v);
+
+// writes one line: count, min, mean, p50, p90, p99, p99.9 and max
+void iovm1_hist_dump(const struct iovm1_hist_t *h, const char *name, FILE *f);
+
+void iovm1_hists_init(struct iovm1_hists_t *hs);
+
+void iovm1_hists_hook(struct iovm1_hists_t *hs, struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg);
+
+// writes iovm1_hist_dump() lines for every non-empty histogram
+void iovm1_hists_dump(const struct iovm1_hists_t *hs, FILE *f);
+
+uint64_t iovm1_hist_now(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //IOVM_HIST_H
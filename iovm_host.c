@@ -0,0 +1,814 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "iovm_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static const struct {
+    uint32_t size;
+    uint8_t writable;
+} chip_defaults[MEM_SNES_SRAM + 1] = {
+    [MEM_SNES_WRAM] = { 0x20000, 1 },
+    [MEM_SNES_VRAM] = { 0x10000, 1 },
+    [MEM_SNES_CGRAM] = { 0x200, 1 },
+    [MEM_SNES_OAM] = { 0x220, 1 },
+    [MEM_SNES_ARAM] = { 0x10000, 1 },
+    [MEM_SNES_2C00] = { 0x800, 1 },
+    [MEM_SNES_ROM] = { 0, 0 },
+    [MEM_SNES_SRAM] = { 0, 1 },
+};
+
+int iovm1_host_init(struct iovm1_host_t *h, uint32_t rom_size, uint32_t sram_size) {
+    memset(h, 0, sizeof(*h));
+
+    if (rom_size > (1UL << 24) || sram_size > (1UL << 24)) {
+        return -1;
+    }
+
+    for (int c = 0; c <= MEM_SNES_SRAM; c++) {
+        struct iovm1_host_chip_t *ch = &h->chip[c];
+
+        ch->size = chip_defaults[c].size;
+        if (c == MEM_SNES_ROM) {
+            ch->size = rom_size;
+        } else if (c == MEM_SNES_SRAM) {
+            ch->size = sram_size;
+        }
+        ch->readable = 1;
+        ch->writable = chip_defaults[c].writable;
+        ch->map_writable = ch->writable;
+
+        if (ch->size && !(ch->mem = (uint8_t *)calloc(1, ch->size))) {
+            iovm1_host_free(h);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void iovm1_host_release(struct iovm1_host_chip_t *ch) {
+    if (ch->map) {
+        munmap(ch->map, ch->map_len);
+    } else {
+        free(ch->mem);
+    }
+    ch->map = 0;
+    ch->map_len = 0;
+    ch->mem = 0;
+    ch->size = 0;
+}
+
+void iovm1_host_free(struct iovm1_host_t *h) {
+    for (int c = 0; c < IOVM1_HOST_CHIPS; c++) {
+        iovm1_host_release(&h->chip[c]);
+    }
+}
+
+int iovm1_host_register_chip(struct iovm1_host_t *h, enum iovm1_memory_chip c, const struct iovm1_host_chip_desc_t *d) {
+    struct iovm1_host_chip_t *ch;
+    uint8_t *mem;
+
+    if ((unsigned)c >= IOVM1_HOST_CHIPS || d->size == 0 || d->size > (1UL << 24)) {
+        return -1;
+    }
+    if (!(mem = (uint8_t *)calloc(1, d->size))) {
+        return -1;
+    }
+
+    ch = &h->chip[c];
+    iovm1_host_release(ch);
+    ch->mem = mem;
+    ch->size = d->size;
+    ch->readable = d->readable;
+    ch->writable = d->writable;
+    ch->map_writable = d->writable;
+    ch->banks = 0;
+    ch->ctx = d->ctx;
+    ch->refresh = d->refresh;
+    ch->commit = d->commit;
+    return 0;
+}
+
+static inline void iovm1_host_put32(uint8_t *d, uint32_t v) {
+    d[0] = (uint8_t)v;
+    d[1] = (uint8_t)(v >> 8);
+    d[2] = (uint8_t)(v >> 16);
+    d[3] = (uint8_t)(v >> 24);
+}
+
+static inline void iovm1_host_put64(uint8_t *d, uint64_t v) {
+    iovm1_host_put32(d, (uint32_t)v);
+    iovm1_host_put32(d + 4, (uint32_t)(v >> 32));
+}
+
+// snapshots every counter at once whatever part of the chip is read:
+static void iovm1_host_stats_refresh(
+    void *ctx,
+    struct iovm1_host_t *h,
+    enum iovm1_memory_chip c,
+    uint32_t o,
+    uint32_t l
+) {
+    uint8_t *d = h->chip[c].mem;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    iovm1_host_put32(d + IOVM1_HOST_STAT_FRAME, __atomic_load_n(&h->frame, __ATOMIC_RELAXED));
+    iovm1_host_put32(d + IOVM1_HOST_STAT_FRAME_TIME_US, __atomic_load_n(&h->stats.frame_time_us, __ATOMIC_RELAXED));
+    iovm1_host_put64(d + IOVM1_HOST_STAT_NOW_US, (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000);
+    iovm1_host_put64(d + IOVM1_HOST_STAT_VBLANK_US, __atomic_load_n(&h->stats.vblank_us, __ATOMIC_RELAXED));
+    iovm1_host_put32(d + IOVM1_HOST_STAT_QUEUE_DEPTH, __atomic_load_n(&h->stats.queue_depth, __ATOMIC_RELAXED));
+    iovm1_host_put64(d + IOVM1_HOST_STAT_CACHE_HITS, __atomic_load_n(&h->stats.cache_hits, __ATOMIC_RELAXED));
+    iovm1_host_put64(d + IOVM1_HOST_STAT_CACHE_MISSES, __atomic_load_n(&h->stats.cache_misses, __ATOMIC_RELAXED));
+    iovm1_host_put64(d + IOVM1_HOST_STAT_SEQ_WAITS, __atomic_load_n(&h->seq_waits, __ATOMIC_RELAXED));
+    iovm1_host_put64(d + IOVM1_HOST_STAT_SEQ_RETRIES, __atomic_load_n(&h->seq_retries, __ATOMIC_RELAXED));
+}
+
+int iovm1_host_enable_stats(struct iovm1_host_t *h, enum iovm1_memory_chip c) {
+    struct iovm1_host_chip_desc_t d = { IOVM1_HOST_STATS_SIZE, 1, 0, 0, iovm1_host_stats_refresh, 0 };
+
+    return iovm1_host_register_chip(h, c, &d);
+}
+
+int iovm1_host_map_file(
+    struct iovm1_host_t *h,
+    enum iovm1_memory_chip c,
+    const char *path,
+    uint64_t offset,
+    uint32_t size,
+    int flags
+) {
+    struct iovm1_host_chip_t *ch;
+    struct stat st;
+    uint64_t base;
+    size_t len;
+    void *map;
+    int fd;
+    int e;
+
+    if ((unsigned)c >= IOVM1_HOST_CHIPS) {
+        errno = EINVAL;
+        return -1;
+    }
+    ch = &h->chip[c];
+
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0) {
+        goto fail;
+    }
+
+    if (size == 0) {
+        size = offset < (uint64_t)st.st_size ? (uint32_t)((uint64_t)st.st_size - offset) : 0;
+    }
+    // touching pages past the end of the file raises SIGBUS, so the whole range must exist:
+    if (size == 0 || size > (1UL << 24) || offset + size > (uint64_t)st.st_size) {
+        errno = EINVAL;
+        goto fail;
+    }
+
+    base = offset & ~(uint64_t)(sysconf(_SC_PAGESIZE) - 1);
+    len = (size_t)(offset - base) + size;
+    map = mmap(
+        0,
+        len,
+        (flags & IOVM1_HOST_MAP_COPY_ON_WRITE) ? PROT_READ | PROT_WRITE : PROT_READ,
+        MAP_PRIVATE,
+        fd,
+        (off_t)base
+    );
+    if (map == MAP_FAILED) {
+        goto fail;
+    }
+    close(fd);
+
+    // hints are advisory; ignore failures:
+    if (flags & IOVM1_HOST_MAP_SEQUENTIAL) {
+        madvise(map, len, MADV_SEQUENTIAL);
+    } else if (flags & IOVM1_HOST_MAP_RANDOM) {
+        madvise(map, len, MADV_RANDOM);
+    }
+
+    iovm1_host_release(ch);
+    ch->map = map;
+    ch->map_len = len;
+    ch->mem = (uint8_t *)map + (offset - base);
+    ch->size = size;
+    ch->readable = 1;
+    ch->writable = (flags & IOVM1_HOST_MAP_COPY_ON_WRITE) ? ch->map_writable : 0;
+    return 0;
+
+fail:
+    e = errno;
+    close(fd);
+    errno = e;
+    return -1;
+}
+
+// maps `n` bytes from bank offset `lo` to chip offset `o`, mirrored over a chip of `size` bytes:
+static void iovm1_host_bank_set(struct iovm1_host_bank_t *b, uint32_t size, uint32_t lo, uint32_t n, uint32_t o) {
+    if (!size) {
+        b->n = 0;
+        return;
+    }
+    b->lo = lo;
+    b->base = o % size;
+    // mirroring only happens at window granularity; a chip smaller than the window maps its size once:
+    b->n = n < size - b->base ? n : size - b->base;
+}
+
+void iovm1_host_set_mapping(struct iovm1_host_t *h, enum iovm1_host_mapping m) {
+    uint32_t rom = h->chip[MEM_SNES_ROM].size;
+    uint32_t sram = h->chip[MEM_SNES_SRAM].size;
+
+    memset(h->rom_banks, 0, sizeof(h->rom_banks));
+    memset(h->sram_banks, 0, sizeof(h->sram_banks));
+    h->mapping = m;
+    h->chip[MEM_SNES_ROM].banks = m ? h->rom_banks : 0;
+    h->chip[MEM_SNES_SRAM].banks = m ? h->sram_banks : 0;
+
+    for (uint32_t bank = 0; bank < 256; bank++) {
+        uint32_t b = bank & 0x7F;
+        struct iovm1_host_bank_t *r = &h->rom_banks[bank];
+        struct iovm1_host_bank_t *s = &h->sram_banks[bank];
+
+        switch (m) {
+            case IOVM1_HOST_MAPPING_LOROM:
+                // $00-$7D,$80-$FF:8000-FFFF is ROM in 32 KiB pages; $70-$7D,$F0-$FF:0000-7FFF is SRAM:
+                if (bank < 0x7E || bank >= 0x80) {
+                    iovm1_host_bank_set(r, rom, 0x8000, 0x8000, b << 15);
+                }
+                if ((bank >= 0x70 && bank < 0x7E) || bank >= 0xF0) {
+                    iovm1_host_bank_set(s, sram, 0x0000, 0x8000, (bank & 0x0F) << 15);
+                }
+                break;
+            case IOVM1_HOST_MAPPING_HIROM:
+                // $40-$7D,$C0-$FF:0000-FFFF is ROM in 64 KiB pages, mirrored at $00-$3F,$80-$BF:8000-FFFF:
+                if (bank >= 0xC0 || (bank >= 0x40 && bank < 0x7E)) {
+                    iovm1_host_bank_set(r, rom, 0x0000, 0x10000, (b & 0x3F) << 16);
+                } else if (b < 0x40) {
+                    iovm1_host_bank_set(r, rom, 0x8000, 0x8000, ((b & 0x3F) << 16) | 0x8000);
+                }
+                // $20-$3F,$A0-$BF:6000-7FFF is SRAM in 8 KiB pages:
+                if (b >= 0x20 && b < 0x40) {
+                    iovm1_host_bank_set(s, sram, 0x6000, 0x2000, (b - 0x20) << 13);
+                }
+                break;
+            case IOVM1_HOST_MAPPING_EXHIROM:
+                // like HiROM with the first 4 MiB at $C0-$FF and $80-$BF and the second at $40-$7D and $00-$3F:
+                if (bank >= 0xC0 || (bank >= 0x40 && bank < 0x7E)) {
+                    iovm1_host_bank_set(r, rom, 0x0000, 0x10000, ((bank & 0x80) ? 0 : 0x400000) | ((b & 0x3F) << 16));
+                } else if (b < 0x40) {
+                    iovm1_host_bank_set(
+                        r, rom, 0x8000, 0x8000,
+                        ((bank & 0x80) ? 0 : 0x400000) | ((b & 0x3F) << 16) | 0x8000
+                    );
+                }
+                if (b >= 0x20 && b < 0x40) {
+                    iovm1_host_bank_set(s, sram, 0x6000, 0x2000, (b - 0x20) << 13);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+#ifdef IOVM1_USE_CHIP_TABLE
+void iovm1_host_chip_table(struct iovm1_host_t *h, struct iovm1_chip_t t[IOVM1_HOST_CHIPS]) {
+    for (int c = 0; c < IOVM1_HOST_CHIPS; c++) {
+        const struct iovm1_host_chip_t *ch = &h->chip[c];
+
+        t[c].size = ch->mem ? ch->size : 0;
+        if (t[c].size && ch->banks) {
+            t[c].size = 1UL << 24;
+        }
+        t[c].flags = (ch->readable ? IOVM1_CHIP_READABLE : 0) | (ch->writable ? IOVM1_CHIP_WRITABLE : 0);
+    }
+}
+#endif
+
+// resolves address `a` on chip `c` to a chip offset `*o` and the number of bytes `*run` contiguous from there:
+static inline enum iovm1_error iovm1_host_resolve(
+    struct iovm1_host_t *h,
+    enum iovm1_memory_chip c,
+    uint24_t a,
+    int write,
+    uint32_t *o,
+    uint32_t *run
+) {
+    const struct iovm1_host_chip_t *ch;
+
+    if ((unsigned)c >= IOVM1_HOST_CHIPS || !h->chip[c].mem) {
+        return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+    }
+    ch = &h->chip[c];
+    if (ch->banks) {
+        const struct iovm1_host_bank_t *b = &ch->banks[(a >> 16) & 0xFF];
+        uint32_t off = (a & 0xFFFF) - b->lo;
+
+        // unsigned wrap-around also rejects offsets below the window:
+        if (off >= b->n) {
+            return IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE;
+        }
+        *o = b->base + off;
+        *run = b->n - off;
+    } else {
+        if (a >= ch->size) {
+            return IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE;
+        }
+        *o = a;
+        *run = ch->size - a;
+    }
+    if (write ? !ch->writable : !ch->readable) {
+        return write ? IOVM1_ERROR_MEMORY_CHIP_NOT_WRITABLE : IOVM1_ERROR_MEMORY_CHIP_NOT_READABLE;
+    }
+
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error iovm1_host_check(struct iovm1_host_t *h, enum iovm1_memory_chip c, uint24_t a, uint32_t l, int write) {
+    enum iovm1_error e;
+    uint32_t o, run;
+
+    // one resolve per contiguous window the range touches:
+    for (;;) {
+        if ((e = iovm1_host_resolve(h, c, a, write, &o, &run)) != IOVM1_SUCCESS) {
+            return e;
+        }
+        if (run >= l) {
+            return IOVM1_SUCCESS;
+        }
+        a += run;
+        l -= run;
+    }
+}
+
+// busy-waits for the simulated access time of `l` bytes on chip `c`:
+static void iovm1_host_delay(struct iovm1_host_t *h, enum iovm1_memory_chip c, uint32_t l) {
+    struct timespec ts;
+    uint64_t t0, ns;
+
+    if (!h->chip[c].latency_ns) {
+        return;
+    }
+
+    ns = (uint64_t)h->chip[c].latency_ns * l;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    t0 = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+    } while ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec - t0 < ns);
+}
+
+// lets a virtual region fill chip offsets `[o, o+l)` before they are read:
+static inline void iovm1_host_refresh(struct iovm1_host_t *h, enum iovm1_memory_chip c, uint32_t o, uint32_t l) {
+    const struct iovm1_host_chip_t *ch = &h->chip[c];
+
+    if (ch->refresh) {
+        ch->refresh(ch->ctx, h, c, o, l);
+    }
+}
+
+// lets a virtual region act on chip offsets `[o, o+l)` after they were written:
+static inline void iovm1_host_commit(struct iovm1_host_t *h, enum iovm1_memory_chip c, uint32_t o, uint32_t l) {
+    const struct iovm1_host_chip_t *ch = &h->chip[c];
+
+    if (ch->commit) {
+        ch->commit(ch->ctx, h, c, o, l);
+    }
+}
+
+static inline void iovm1_host_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// returns the even sequence of a published frame to read against, spinning while a frame is being published:
+static inline uint32_t iovm1_host_read_begin(struct iovm1_host_t *h) {
+    uint32_t seq;
+
+    if (!h->seqlock) {
+        return 0;
+    }
+    if ((seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE)) & 1) {
+        int spins = 0;
+
+        __atomic_add_fetch(&h->seq_waits, 1, __ATOMIC_RELAXED);
+        do {
+            // the publisher may have been preempted mid-frame; stop burning its CPU after a short spin:
+            if (++spins < 64) {
+                iovm1_host_cpu_relax();
+            } else {
+                sched_yield();
+            }
+        } while ((seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE)) & 1);
+    }
+    return seq;
+}
+
+// returns nonzero when a frame was published since iovm1_host_read_begin() and the read must be repeated:
+static inline int iovm1_host_read_retry(struct iovm1_host_t *h, uint32_t seq) {
+    if (!h->seqlock) {
+        return 0;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&h->seq, __ATOMIC_RELAXED) != seq) {
+        __atomic_add_fetch(&h->seq_retries, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+    return 0;
+}
+
+void iovm1_host_publish_begin(struct iovm1_host_t *h) {
+    __atomic_store_n(&h->seq, h->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void iovm1_host_publish_end(struct iovm1_host_t *h) {
+    __atomic_store_n(&h->seq, h->seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline void iovm1_host_reply(struct iovm1_host_t *h, struct iovm1_t *vm, enum iovm1_host_reply r,
+                                    const uint8_t *d, uint32_t l) {
+    if (h->reply) {
+        h->reply(h->ctx, vm, r, d, l);
+    }
+}
+
+enum iovm1_error iovm1_host_read_state_machine(struct iovm1_host_t *h, struct iovm1_t *vm) {
+    const uint8_t *d;
+    enum iovm1_error e;
+    uint8_t buf[256];
+    uint32_t seq;
+    uint32_t o, n;
+
+    // a read crossing a window boundary replies once per window:
+    if ((e = iovm1_host_resolve(h, vm->rd.c, vm->rd.a, 0, &o, &n)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    // validate the whole range up front so a failing read never replies partially:
+    if (vm->rd.os == IOVM1_OPSTATE_INIT && n < (uint32_t)vm->rd.l &&
+        (e = iovm1_host_check(h, vm->rd.c, vm->rd.a + n, (uint32_t)vm->rd.l - n, 0)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    if (n > (uint32_t)vm->rd.l) {
+        n = (uint32_t)vm->rd.l;
+    }
+    if (h->chunk && n > h->chunk) {
+        n = h->chunk;
+    }
+
+    iovm1_host_delay(h, vm->rd.c, n);
+    iovm1_host_refresh(h, vm->rd.c, o, n);
+    d = &h->chip[vm->rd.c].mem[o];
+    if (h->seqlock) {
+        // copy out of the published frame so the reply cannot be torn:
+        do {
+            seq = iovm1_host_read_begin(h);
+            memcpy(buf, d, n);
+        } while (iovm1_host_read_retry(h, seq));
+        d = buf;
+    }
+    iovm1_host_reply(h, vm, IOVM1_HOST_REPLY_READ, d, n);
+    vm->rd.a += n;
+    vm->rd.l -= (int)n;
+
+    vm->rd.os = vm->rd.l > 0 ? IOVM1_OPSTATE_CONTINUE : IOVM1_OPSTATE_COMPLETED;
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error iovm1_host_write_state_machine(struct iovm1_host_t *h, struct iovm1_t *vm) {
+    enum iovm1_error e;
+    uint32_t o, n;
+
+    if ((e = iovm1_host_resolve(h, vm->wr.c, vm->wr.a, 1, &o, &n)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    if (vm->wr.os == IOVM1_OPSTATE_INIT && n < (uint32_t)vm->wr.l &&
+        (e = iovm1_host_check(h, vm->wr.c, vm->wr.a + n, (uint32_t)vm->wr.l - n, 1)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    if (n > (uint32_t)vm->wr.l) {
+        n = (uint32_t)vm->wr.l;
+    }
+    if (h->chunk && n > h->chunk) {
+        n = h->chunk;
+    }
+
+    iovm1_host_delay(h, vm->wr.c, n);
+    memcpy(&h->chip[vm->wr.c].mem[o], &vm->m.ptr[vm->wr.p], n);
+    iovm1_host_commit(h, vm->wr.c, o, n);
+    vm->wr.a += n;
+    vm->wr.p += n;
+    vm->wr.l -= (int)n;
+
+    vm->wr.os = vm->wr.l > 0 ? IOVM1_OPSTATE_CONTINUE : IOVM1_OPSTATE_COMPLETED;
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error iovm1_host_wait_state_machine(struct iovm1_host_t *h, struct iovm1_t *vm) {
+    enum iovm1_error e;
+    uint32_t seq;
+    uint32_t o, run;
+    uint8_t b;
+
+    if ((e = iovm1_host_resolve(h, vm->wa.c, vm->wa.a, 0, &o, &run)) != IOVM1_SUCCESS) {
+        return e;
+    }
+
+    iovm1_host_delay(h, vm->wa.c, 1);
+    iovm1_host_refresh(h, vm->wa.c, o, 1);
+    do {
+        seq = iovm1_host_read_begin(h);
+        b = h->chip[vm->wa.c].mem[o];
+    } while (iovm1_host_read_retry(h, seq));
+    if (iovm1_memory_wait_test_byte(vm, b)) {
+        vm->wa.os = IOVM1_OPSTATE_COMPLETED;
+        return IOVM1_SUCCESS;
+    }
+
+    // let the simulation advance before the next poll:
+    if (h->tick) {
+        h->tick(h->ctx, vm);
+    }
+    vm->wa.os = IOVM1_OPSTATE_CONTINUE;
+    return IOVM1_SUCCESS;
+}
+
+// copies an already checked range spanning several windows into `buf`:
+static const uint8_t *iovm1_host_gather(
+    struct iovm1_host_t *h,
+    enum iovm1_memory_chip c,
+    uint24_t a,
+    uint32_t l,
+    uint8_t *buf
+) {
+    uint32_t o, run;
+    uint8_t *p = buf;
+
+    while (l && iovm1_host_resolve(h, c, a, 0, &o, &run) == IOVM1_SUCCESS) {
+        if (run > l) {
+            run = l;
+        }
+        iovm1_host_refresh(h, c, o, run);
+        memcpy(p, &h->chip[c].mem[o], run);
+        p += run;
+        a += run;
+        l -= run;
+    }
+    return buf;
+}
+
+enum iovm1_error iovm1_host_verify_state_machine(struct iovm1_host_t *h, struct iovm1_t *vm) {
+    const uint8_t *actual;
+    enum iovm1_error e;
+    uint8_t buf[256];
+    uint32_t seq;
+    uint32_t o, run;
+    uint8_t d[32];
+    int i;
+
+    if ((e = iovm1_host_resolve(h, vm->vf.c, vm->vf.a, 0, &o, &run)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    // the rest of a range spanning several windows:
+    if (run < (uint32_t)vm->vf.l &&
+        (e = iovm1_host_check(h, vm->vf.c, vm->vf.a + run, (uint32_t)vm->vf.l - run, 0)) != IOVM1_SUCCESS) {
+        return e;
+    }
+
+    actual = &h->chip[vm->vf.c].mem[o];
+    iovm1_host_delay(h, vm->vf.c, (uint32_t)vm->vf.l);
+    if (run >= (uint32_t)vm->vf.l) {
+        iovm1_host_refresh(h, vm->vf.c, o, (uint32_t)vm->vf.l);
+    }
+    if (vm->vf.r == IOVM1_COMPARE_REPLY_FIRST_MISMATCH) {
+        do {
+            seq = iovm1_host_read_begin(h);
+            if (run < (uint32_t)vm->vf.l) {
+                actual = iovm1_host_gather(h, vm->vf.c, vm->vf.a, (uint32_t)vm->vf.l, buf);
+            }
+            i = iovm1_memory_first_mismatch(&vm->m.ptr[vm->vf.p], actual, vm->vf.l);
+        } while (iovm1_host_read_retry(h, seq));
+        d[0] = (uint8_t)i;
+        d[1] = (uint8_t)(i >> 8);
+        iovm1_host_reply(h, vm, IOVM1_HOST_REPLY_VERIFY, d, 2);
+    } else {
+        do {
+            seq = iovm1_host_read_begin(h);
+            if (run < (uint32_t)vm->vf.l) {
+                actual = iovm1_host_gather(h, vm->vf.c, vm->vf.a, (uint32_t)vm->vf.l, buf);
+            }
+            iovm1_memory_mismatch(&vm->m.ptr[vm->vf.p], actual, vm->vf.l, d);
+        } while (iovm1_host_read_retry(h, seq));
+        iovm1_host_reply(h, vm, IOVM1_HOST_REPLY_VERIFY, d, 32);
+    }
+
+    vm->vf.os = IOVM1_OPSTATE_COMPLETED;
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error iovm1_host_search_state_machine(struct iovm1_host_t *h, struct iovm1_t *vm) {
+    const uint8_t *k = vm->sr.k ? &vm->m.ptr[vm->sr.k] : 0;
+    const uint8_t *base, *p;
+    enum iovm1_error e;
+    uint24_t found[256];
+    uint32_t seq;
+    uint32_t o, run;
+    uint32_t hl;
+    uint8_t d[3];
+    int n;
+
+    // the haystack must be contiguous in one window; matches are reported at their address on the chip:
+    if ((e = iovm1_host_resolve(h, vm->sr.c, vm->sr.a, 0, &o, &run)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    if (run < vm->sr.l) {
+        return IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE;
+    }
+
+    base = &h->chip[vm->sr.c].mem[o];
+    iovm1_host_delay(h, vm->sr.c, vm->sr.l);
+    iovm1_host_refresh(h, vm->sr.c, o, vm->sr.l);
+    // collect every match first so a search repeated against a newer frame never replies twice:
+    do {
+        seq = iovm1_host_read_begin(h);
+        p = base;
+        hl = vm->sr.l;
+        n = 0;
+        while (n < vm->sr.m) {
+            uint32_t i = iovm1_memory_search(p, hl, &vm->m.ptr[vm->sr.p], k, vm->sr.n);
+
+            if (i == hl) {
+                break;
+            }
+            found[n++] = vm->sr.a + (uint24_t)(p + i - base);
+
+            p += i + 1;
+            hl -= i + 1;
+        }
+    } while (iovm1_host_read_retry(h, seq));
+
+    for (int j = 0; j < n; j++) {
+        d[0] = (uint8_t)found[j];
+        d[1] = (uint8_t)(found[j] >> 8);
+        d[2] = (uint8_t)(found[j] >> 16);
+        iovm1_host_reply(h, vm, IOVM1_HOST_REPLY_SEARCH, d, 3);
+    }
+
+    vm->sr.os = IOVM1_OPSTATE_COMPLETED;
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error iovm1_host_try_read_byte(
+    struct iovm1_host_t *h,
+    enum iovm1_memory_chip c,
+    uint24_t a,
+    uint8_t *b
+) {
+    enum iovm1_error e;
+    uint32_t seq;
+    uint32_t o, run;
+
+    if ((e = iovm1_host_resolve(h, c, a, 0, &o, &run)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    iovm1_host_delay(h, c, 1);
+    iovm1_host_refresh(h, c, o, 1);
+    do {
+        seq = iovm1_host_read_begin(h);
+        *b = h->chip[c].mem[o];
+    } while (iovm1_host_read_retry(h, seq));
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error iovm1_host_try_write_byte(
+    struct iovm1_host_t *h,
+    enum iovm1_memory_chip c,
+    uint24_t a,
+    uint8_t b
+) {
+    enum iovm1_error e;
+    uint32_t o, run;
+
+    if ((e = iovm1_host_resolve(h, c, a, 1, &o, &run)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    iovm1_host_delay(h, c, 1);
+    h->chip[c].mem[o] = b;
+    iovm1_host_commit(h, c, o, 1);
+    return IOVM1_SUCCESS;
+}
+
+void iovm1_host_game_init(struct iovm1_host_game_t *g, struct iovm1_host_t *h, uint32_t hz, uint24_t frame_addr) {
+    memset(g, 0, sizeof(*g));
+    g->h = h;
+    g->hz = hz ? hz : 60;
+    g->frame_addr = frame_addr;
+}
+
+int iovm1_host_game_add_region(
+    struct iovm1_host_game_t *g,
+    enum iovm1_memory_chip c,
+    uint24_t a,
+    uint32_t l,
+    uint8_t step
+) {
+    struct iovm1_host_region_t *r;
+    uint32_t o, run;
+
+    if (g->n_regions >= IOVM1_HOST_GAME_REGIONS || iovm1_host_resolve(g->h, c, a, 1, &o, &run) != IOVM1_SUCCESS ||
+        run < l) {
+        return -1;
+    }
+
+    r = &g->regions[g->n_regions++];
+    r->c = c;
+    r->a = a;
+    r->o = o;
+    r->l = l;
+    r->step = step;
+    return 0;
+}
+
+static void *iovm1_host_game_main(void *arg) {
+    struct iovm1_host_game_t *g = (struct iovm1_host_game_t *)arg;
+    struct iovm1_host_t *h = g->h;
+    uint64_t period = 1000000000ULL / g->hz;
+    struct timespec next, now;
+    uint64_t last = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!__atomic_load_n(&g->stop, __ATOMIC_ACQUIRE)) {
+        uint64_t t;
+        uint32_t frame;
+
+        // absolute deadlines keep the frame rate from drifting:
+        next.tv_nsec += (long)period;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, 0);
+
+        // scripted regions first so a VM woken by the frame counter observes this frame's memory:
+        iovm1_host_publish_begin(h);
+        for (uint32_t i = 0; i < g->n_regions; i++) {
+            struct iovm1_host_region_t *r = &g->regions[i];
+            uint8_t *m = &h->chip[r->c].mem[r->o];
+            for (uint32_t j = 0; j < r->l; j++) {
+                __atomic_store_n(&m[j], (uint8_t)(m[j] + r->step), __ATOMIC_RELAXED);
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        t = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+        __atomic_store_n(&g->vblank_ns, t, __ATOMIC_RELAXED);
+        __atomic_store_n(&h->stats.vblank_us, t / 1000, __ATOMIC_RELAXED);
+        if (last) {
+            __atomic_store_n(&h->stats.frame_time_us, (uint32_t)((t - last) / 1000), __ATOMIC_RELAXED);
+        }
+        last = t;
+        frame = __atomic_add_fetch(&h->frame, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&h->chip[MEM_SNES_WRAM].mem[g->frame_addr], 1, __ATOMIC_RELEASE);
+        iovm1_host_publish_end(h);
+
+        if (g->vblank) {
+            g->vblank(g->ctx, frame, t);
+        }
+    }
+
+    return 0;
+}
+
+int iovm1_host_game_start(struct iovm1_host_game_t *g) {
+    if (g->frame_addr >= g->h->chip[MEM_SNES_WRAM].size) {
+        return -1;
+    }
+
+    g->stop = 0;
+    return pthread_create(&g->thread, 0, iovm1_host_game_main, g) == 0 ? 0 : -1;
+}
+
+void iovm1_host_game_stop(struct iovm1_host_game_t *g) {
+    __atomic_store_n(&g->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(g->thread, 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,351 @@
+#ifndef IOVM_HOST_H
+#define IOVM_HOST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    iovm_host.h: reference simulated SNES host
+
+    models every `enum iovm1_memory_chip` as a real buffer with its hardware size and access rights, and
+    implements the host state machines against them with IOVM1_ERROR_MEMORY_CHIP_* errors:
+
+        chip        size                readable    writable
+        WRAM        128 KiB             yes         yes
+        VRAM        64 KiB              yes         yes
+        CGRAM       512 bytes           yes         yes
+        OAM         544 bytes           yes         yes
+        ARAM        64 KiB              yes         yes
+        2C00        2 KiB               yes         yes
+        ROM         rom_size            yes         no
+        SRAM        sram_size           yes         yes
+
+    the functions here take the host explicitly and do not define any `host_*` symbols, so they can be embedded in
+    a larger host. link iovm_host_glue.c to get `host_*` definitions which forward to the host found in the VM's
+    userdata (with IOVM1_USE_USERDATA) or else to `iovm1_host_default`.
+
+    optional realism:
+        chip[c].latency_ns  busy-waits this many nanoseconds per byte accessed on chip `c`
+        chunk               transfers at most this many bytes per READ/WRITE state machine call and returns
+                            IOVM1_OPSTATE_CONTINUE until done; 0 transfers everything in one call
+        tick                called after every unsuccessful WAIT_UNTIL poll so a simulation can advance; each
+                            wait state machine call polls once and returns IOVM1_OPSTATE_CONTINUE until satisfied
+
+    an optional game thread (`struct iovm1_host_game_t`) makes memory change underneath the VM. at a configurable
+    frame rate it increments a frame counter byte, adds a step to each scripted region, advances `frame` and calls
+    a vblank hook; WAIT_UNTIL on the frame counter byte therefore wakes up once per simulated vblank.
+
+    every chip id indexes a 256-entry table of chip descriptors, so accesses dispatch with one lookup whichever chip
+    they target. iovm1_host_init() defines the eight SNES chips; cartridge expansion chips (SA-1 I-RAM and BW-RAM,
+    SuperFX RAM, MSU-1 data) and host-side virtual regions from MEM_HOST_FIRST up are defined with
+    iovm1_host_register_chip(). a virtual region is a buffer with `refresh` and `commit` callbacks: `refresh` fills
+    the bytes about to be read, e.g. from device status, and `commit` acts on bytes just written. chips without
+    callbacks cost nothing extra.
+
+    iovm1_host_enable_stats() registers a read-only statistics chip, a virtual region whose bytes are live host
+    counters (little-endian), so a program can READ, WAIT_UNTIL or ABORT_UNLESS on device telemetry next to game
+    state without a separate request. every access refreshes the whole chip at once, so a multi-byte READ sees one
+    consistent snapshot:
+
+        offset  size    counter
+        $00     4       frame                   `frame`
+        $04     4       frame_time_us           duration of the last frame, from the game thread
+        $08     8       now_us                  CLOCK_MONOTONIC at the access
+        $10     8       vblank_us               CLOCK_MONOTONIC at the last vblank, from the game thread
+        $18     4       queue_depth             `stats.queue_depth`, set by the embedding host
+        $1C     4       reserved; reads 0
+        $20     8       cache_hits              `stats.cache_hits`, set by the embedding host
+        $28     8       cache_misses            `stats.cache_misses`, set by the embedding host
+        $30     8       seq_waits               `seq_waits`
+        $38     8       seq_retries             `seq_retries`
+
+    chips can instead be backed by a file with iovm1_host_map_file(), e.g. a ROM image or a save-state/memory dump,
+    so programs run against recorded game states without copying them. mappings are always MAP_PRIVATE: read-only,
+    or copy-on-write where the VM's writes stay in memory and never reach the file.
+
+    ROM and SRAM are addressed by chip offset until iovm1_host_set_mapping() selects a cartridge mapping; from then
+    on their addresses are 24-bit SNES bus addresses (bank:offset). the mapping is precomputed into one entry per
+    bank giving the window of bank offsets mapped and its chip offset, so every access resolves with one lookup
+    and an access crossing a window boundary is split where the window ends:
+
+        mapping     ROM                                         SRAM
+        LOROM       $00-$7D,$80-$FF:8000-FFFF, 32 KiB pages     $70-$7D,$F0-$FF:0000-7FFF, 32 KiB pages
+        HIROM       $40-$7D,$C0-$FF:0000-FFFF, 64 KiB pages     $20-$3F,$A0-$BF:6000-7FFF, 8 KiB pages
+                    mirrored at $00-$3F,$80-$BF:8000-FFFF
+        EXHIROM     as HIROM, with $00-$7D holding the second   as HIROM
+                    4 MiB of ROM
+
+    windows mirror over smaller chips; a chip smaller than one window maps only its size. SEARCH haystacks must
+    lie in one window.
+
+    memory shared with an emulator thread can be published under a sequence lock: the emulator brackets each
+    frame's writes with iovm1_host_publish_begin()/iovm1_host_publish_end() (the game thread always does), and
+    with `seqlock` set every host access reads only published frames, repeating the access whenever a frame was
+    published during it. READ replies are copied out of the frame so multi-byte values are never torn; with
+    `chunk` set each chunk is consistent on its own. the emulator never blocks; accesses which had to wait for a frame
+    are counted in `seq_waits` and repeated accesses in `seq_retries`.
+
+    READ data, COMPARE/WRITE_VERIFY results and SEARCH matches are passed to `reply`:
+        IOVM1_HOST_REPLY_READ           the bytes read, possibly over several calls when chunked
+        IOVM1_HOST_REPLY_VERIFY         32 byte mismatch bitmap, or 2 byte little-endian first mismatch offset
+        IOVM1_HOST_REPLY_SEARCH         3 byte little-endian chip address per match
+*/
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "iovm.h"
+
+#define IOVM1_HOST_CHIPS 256
+#define IOVM1_HOST_GAME_REGIONS 8
+
+// chip id suggested for the statistics chip:
+#define IOVM1_HOST_STATS_CHIP ((enum iovm1_memory_chip)MEM_HOST_FIRST)
+
+enum iovm1_host_reply {
+    IOVM1_HOST_REPLY_READ,
+    IOVM1_HOST_REPLY_VERIFY,
+    IOVM1_HOST_REPLY_SEARCH,
+};
+
+// statistics chip offsets:
+enum iovm1_host_stat {
+    IOVM1_HOST_STAT_FRAME = 0x00,
+    IOVM1_HOST_STAT_FRAME_TIME_US = 0x04,
+    IOVM1_HOST_STAT_NOW_US = 0x08,
+    IOVM1_HOST_STAT_VBLANK_US = 0x10,
+    IOVM1_HOST_STAT_QUEUE_DEPTH = 0x18,
+    IOVM1_HOST_STAT_CACHE_HITS = 0x20,
+    IOVM1_HOST_STAT_CACHE_MISSES = 0x28,
+    IOVM1_HOST_STAT_SEQ_WAITS = 0x30,
+    IOVM1_HOST_STAT_SEQ_RETRIES = 0x38,
+    IOVM1_HOST_STATS_SIZE = 0x40,
+};
+
+enum iovm1_host_map_flags {
+    // writable private copy; otherwise the chip becomes read-only:
+    IOVM1_HOST_MAP_COPY_ON_WRITE = 1 << 0,
+    // madvise() access pattern hints:
+    IOVM1_HOST_MAP_SEQUENTIAL = 1 << 1,
+    IOVM1_HOST_MAP_RANDOM = 1 << 2,
+};
+
+enum iovm1_host_mapping {
+    // ROM and SRAM addresses are chip offsets:
+    IOVM1_HOST_MAPPING_NONE,
+    IOVM1_HOST_MAPPING_LOROM,
+    IOVM1_HOST_MAPPING_HIROM,
+    IOVM1_HOST_MAPPING_EXHIROM,
+};
+
+// bank offsets `lo` to `lo + n - 1` map to chip offsets from `base`; `n` is 0 for unmapped banks
+struct iovm1_host_bank_t {
+    uint32_t base;
+    uint32_t lo;
+    uint32_t n;
+};
+
+struct iovm1_host_t;
+
+typedef void (*iovm1_host_chip_sync_f)(
+    void *ctx,
+    struct iovm1_host_t *h,
+    enum iovm1_memory_chip c,
+    uint32_t o,
+    uint32_t l
+);
+
+// backend of a chip defined with iovm1_host_register_chip():
+struct iovm1_host_chip_desc_t {
+    uint32_t size;
+    uint8_t readable;
+    uint8_t writable;
+
+    // called before chip offsets `[o, o+l)` are read resp. after they were written; either may be NULL:
+    void *ctx;
+    iovm1_host_chip_sync_f refresh;
+    iovm1_host_chip_sync_f commit;
+};
+
+struct iovm1_host_chip_t {
+    uint8_t *mem;
+    uint32_t size;
+    uint8_t readable;
+    uint8_t writable;
+    // `writable` when mapped copy-on-write:
+    uint8_t map_writable;
+    uint32_t latency_ns;
+
+    // bus mapping windows per bank, or NULL when addresses are chip offsets:
+    const struct iovm1_host_bank_t *banks;
+
+    void *ctx;
+    iovm1_host_chip_sync_f refresh;
+    iovm1_host_chip_sync_f commit;
+
+    // page aligned mapping containing `mem` when file backed:
+    void *map;
+    size_t map_len;
+};
+
+// counters served by the statistics chip which the host cannot derive itself:
+struct iovm1_host_stats_t {
+    // set by the embedding host:
+    uint32_t queue_depth;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+
+    // set by the game thread:
+    uint32_t frame_time_us;
+    uint64_t vblank_us;
+};
+
+struct iovm1_host_t {
+    struct iovm1_host_chip_t chip[IOVM1_HOST_CHIPS];
+
+    uint32_t chunk;
+
+    enum iovm1_host_mapping mapping;
+    struct iovm1_host_bank_t rom_banks[256];
+    struct iovm1_host_bank_t sram_banks[256];
+
+    void *ctx;
+    void (*reply)(void *ctx, struct iovm1_t *vm, enum iovm1_host_reply r, const uint8_t *d, uint32_t l);
+    void (*tick)(void *ctx, struct iovm1_t *vm);
+    void (*end)(void *ctx, struct iovm1_t *vm);
+#ifdef IOVM1_USE_HOOKS
+    void (*hook)(void *ctx, struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg);
+#endif
+
+    // current video frame, for host_frame_counter():
+    uint32_t frame;
+
+    // read only frames published under `seq`:
+    int seqlock;
+    // odd while a frame is being published:
+    uint32_t seq;
+    // accesses which found a frame being published, and accesses repeated because one was published meanwhile:
+    uint64_t seq_waits;
+    uint64_t seq_retries;
+
+    struct iovm1_host_stats_t stats;
+};
+
+// memory region the game thread changes every frame:
+struct iovm1_host_region_t {
+    enum iovm1_memory_chip c;
+    uint24_t a;
+    uint32_t l;
+    // chip offset `a` resolves to:
+    uint32_t o;
+    // added to every byte of the region each frame:
+    uint8_t step;
+};
+
+struct iovm1_host_game_t {
+    struct iovm1_host_t *h;
+
+    // frames per second:
+    uint32_t hz;
+    // WRAM address of the byte incremented every frame:
+    uint24_t frame_addr;
+
+    struct iovm1_host_region_t regions[IOVM1_HOST_GAME_REGIONS];
+    uint32_t n_regions;
+
+    // called on the game thread right after each frame's memory updates:
+    void *ctx;
+    void (*vblank)(void *ctx, uint32_t frame, uint64_t t_ns);
+
+    // CLOCK_MONOTONIC time of the latest vblank:
+    uint64_t vblank_ns;
+
+    pthread_t thread;
+    int stop;
+};
+
+// allocates zeroed chip buffers; returns 0 on success, -1 when out of memory or a size exceeds 24-bit addressing
+int iovm1_host_init(struct iovm1_host_t *h, uint32_t rom_size, uint32_t sram_size);
+
+void iovm1_host_free(struct iovm1_host_t *h);
+
+// defines chip `c` with a zeroed buffer of `d->size` bytes, replacing any previous definition; returns 0 on success,
+// -1 when `d->size` is 0, exceeds 24-bit addressing or is out of memory
+int iovm1_host_register_chip(struct iovm1_host_t *h, enum iovm1_memory_chip c, const struct iovm1_host_chip_desc_t *d);
+
+// maps `size` bytes of `path` at `offset` onto chip `c` in place of its buffer; `size` 0 maps the rest of the file.
+// returns 0 on success, -1 with errno set on failure leaving the chip as it was
+int iovm1_host_map_file(
+    struct iovm1_host_t *h,
+    enum iovm1_memory_chip c,
+    const char *path,
+    uint64_t offset,
+    uint32_t size,
+    int flags
+);
+
+// registers the statistics chip as chip `c`; returns 0 on success, -1 on failure
+int iovm1_host_enable_stats(struct iovm1_host_t *h, enum iovm1_memory_chip c);
+
+// precomputes the bank tables for ROM and SRAM at their current sizes; call again after resizing or remapping them
+void iovm1_host_set_mapping(struct iovm1_host_t *h, enum iovm1_host_mapping m);
+
+#ifdef IOVM1_USE_CHIP_TABLE
+// fills all IOVM1_HOST_CHIPS entries of `t` with the chips' sizes and access rights for iovm1_set_chips(); with a bus mapping ROM and SRAM span the
+// whole 24-bit address space and the host still resolves their windows
+void iovm1_host_chip_table(struct iovm1_host_t *h, struct iovm1_chip_t t[IOVM1_HOST_CHIPS]);
+#endif
+
+// validates an access of `l` bytes at `a` on chip `c`; `write` selects the access right to check
+enum iovm1_error iovm1_host_check(struct iovm1_host_t *h, enum iovm1_memory_chip c, uint24_t a, uint32_t l, int write);
+
+enum iovm1_error iovm1_host_read_state_machine(struct iovm1_host_t *h, struct iovm1_t *vm);
+enum iovm1_error iovm1_host_write_state_machine(struct iovm1_host_t *h, struct iovm1_t *vm);
+enum iovm1_error iovm1_host_wait_state_machine(struct iovm1_host_t *h, struct iovm1_t *vm);
+enum iovm1_error iovm1_host_verify_state_machine(struct iovm1_host_t *h, struct iovm1_t *vm);
+enum iovm1_error iovm1_host_search_state_machine(struct iovm1_host_t *h, struct iovm1_t *vm);
+
+enum iovm1_error iovm1_host_try_read_byte(
+    struct iovm1_host_t *h,
+    enum iovm1_memory_chip c,
+    uint24_t a,
+    uint8_t *b
+);
+enum iovm1_error iovm1_host_try_write_byte(
+    struct iovm1_host_t *h,
+    enum iovm1_memory_chip c,
+    uint24_t a,
+    uint8_t b
+);
+
+// brackets an emulator's writes to chip memory; only one thread may publish at a time
+void iovm1_host_publish_begin(struct iovm1_host_t *h);
+void iovm1_host_publish_end(struct iovm1_host_t *h);
+
+// prepares a game thread for `h` at `hz` frames per second with the frame counter at WRAM `frame_addr`
+void iovm1_host_game_init(struct iovm1_host_game_t *g, struct iovm1_host_t *h, uint32_t hz, uint24_t frame_addr);
+
+// adds a scripted region; returns -1 when full or out of range
+int iovm1_host_game_add_region(
+    struct iovm1_host_game_t *g,
+    enum iovm1_memory_chip c,
+    uint24_t a,
+    uint32_t l,
+    uint8_t step
+);
+
+int iovm1_host_game_start(struct iovm1_host_game_t *g);
+
+void iovm1_host_game_stop(struct iovm1_host_game_t *g);
+
+#ifndef IOVM1_USE_USERDATA
+// host used by iovm_host_glue.c when VMs carry no userdata
+extern struct iovm1_host_t *iovm1_host_default;
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //IOVM_HOST_H
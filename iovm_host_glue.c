@@ -0,0 +1,90 @@
+#include <time.h>
+
+#include "iovm_host.h"
+
+// `host_*` definitions forwarding to the reference host in iovm_host.c
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef IOVM1_USE_USERDATA
+struct iovm1_host_t *iovm1_host_default;
+#endif
+
+static inline struct iovm1_host_t *host_of(struct iovm1_t *vm) {
+#ifdef IOVM1_USE_USERDATA
+    return (struct iovm1_host_t *)iovm1_get_userdata(vm);
+#else
+    (void) vm;
+    return iovm1_host_default;
+#endif
+}
+
+enum iovm1_error host_memory_read_state_machine(struct iovm1_t *vm) {
+    return iovm1_host_read_state_machine(host_of(vm), vm);
+}
+
+enum iovm1_error host_memory_write_state_machine(struct iovm1_t *vm) {
+    return iovm1_host_write_state_machine(host_of(vm), vm);
+}
+
+enum iovm1_error host_memory_wait_state_machine(struct iovm1_t *vm) {
+    return iovm1_host_wait_state_machine(host_of(vm), vm);
+}
+
+enum iovm1_error host_memory_verify_state_machine(struct iovm1_t *vm) {
+    return iovm1_host_verify_state_machine(host_of(vm), vm);
+}
+
+enum iovm1_error host_memory_search_state_machine(struct iovm1_t *vm) {
+    return iovm1_host_search_state_machine(host_of(vm), vm);
+}
+
+enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t *b) {
+    return iovm1_host_try_read_byte(host_of(vm), c, a, b);
+}
+
+enum iovm1_error host_memory_try_write_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t b) {
+    return iovm1_host_try_write_byte(host_of(vm), c, a, b);
+}
+
+void host_send_end(struct iovm1_t *vm) {
+    struct iovm1_host_t *h = host_of(vm);
+    if (h && h->end) {
+        h->end(h->ctx, vm);
+    }
+}
+
+#ifdef IOVM1_USE_HOOKS
+void host_hook(struct iovm1_t *vm, enum iovm1_hook hk, uint32_t arg) {
+    struct iovm1_host_t *h = host_of(vm);
+    // hooks may fire before the host is attached, e.g. from iovm1_init():
+    if (h && h->hook) {
+        h->hook(h->ctx, vm, hk, arg);
+    }
+}
+#endif
+
+#ifdef IOVM1_USE_SUMMARY
+// microseconds:
+uint64_t host_clock_now(struct iovm1_t *vm) {
+    struct timespec ts;
+    (void) vm;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+uint32_t host_frame_counter(struct iovm1_t *vm) {
+    struct iovm1_host_t *h = host_of(vm);
+    if (!h) {
+        return 0;
+    }
+    // advanced by the game thread:
+    return __atomic_load_n(&h->frame, __ATOMIC_RELAXED);
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,259 @@
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdlib.h>
+
+#include "iovm_metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// histogram bucket bounds in nanoseconds; 16.7ms is one NTSC frame:
+static const uint64_t le_ns[] = {
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    4000000ULL,
+    16700000ULL,
+    33400000ULL,
+    100000000ULL,
+    1000000000ULL,
+};
+
+void iovm1_metrics_init(struct iovm1_metrics_t *m) {
+    memset(m, 0, sizeof(*m));
+    iovm1_prof_init(&m->prof);
+    pthread_mutex_init(&m->lock, 0);
+    pthread_cond_init(&m->cond, 0);
+}
+
+void iovm1_metrics_attach_hists(struct iovm1_metrics_t *m, const struct iovm1_hists_t *hs) {
+    m->hists = hs;
+}
+
+struct iovm1_metric_t *iovm1_metrics_add(
+    struct iovm1_metrics_t *m,
+    enum iovm1_metric_type type,
+    const char *name,
+    const char *labels,
+    const char *help
+) {
+    struct iovm1_metric_t *x;
+
+    if (m->n >= IOVM1_METRICS_MAX) {
+        return 0;
+    }
+
+    x = &m->m[m->n];
+    x->type = type;
+    x->name = name;
+    x->labels = labels;
+    x->help = help;
+    x->v = 0;
+
+    // publish to the writer only once filled in:
+    __atomic_store_n(&m->n, m->n + 1, __ATOMIC_RELEASE);
+    return x;
+}
+
+void iovm1_metric_set(struct iovm1_metric_t *x, double v) {
+    uint64_t b;
+    memcpy(&b, &v, sizeof(b));
+    __atomic_store_n(&x->v, b, __ATOMIC_RELAXED);
+}
+
+void iovm1_metrics_hook(struct iovm1_metrics_t *m, struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg) {
+    if (h == IOVM1_HOOK_STATE) {
+        if (vm->s == IOVM1_STATE_LOADED) {
+            __atomic_store_n(&m->programs_loaded, m->programs_loaded + 1, __ATOMIC_RELAXED);
+        } else if (vm->s >= IOVM1_STATE_ENDED && arg < IOVM1_STATE_ENDED) {
+            __atomic_store_n(&m->programs_executed, m->programs_executed + 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    iovm1_prof_hook(&m->prof, vm, h, arg);
+}
+
+static uint64_t iovm1_metrics_load(const uint64_t *v) {
+    return __atomic_load_n(v, __ATOMIC_RELAXED);
+}
+
+static void iovm1_metrics_header(FILE *f, const char *name, const char *type, const char *help) {
+    fprintf(f, "# HELP iovm_%s %s\n# TYPE iovm_%s %s\n", name, help, name, type);
+}
+
+static void iovm1_metrics_histogram(FILE *f, const char *name, const char *help, const struct iovm1_hist_t *h) {
+    uint64_t count = __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+
+    iovm1_metrics_header(f, name, "histogram", help);
+    for (unsigned i = 0; i < sizeof(le_ns) / sizeof(le_ns[0]); i++) {
+        uint64_t n = iovm1_hist_count_at_most(h, le_ns[i]);
+        fprintf(f, "iovm_%s_bucket{le=\"%g\"} %llu\n",
+            name,
+            (double)le_ns[i] * 1e-9,
+            (unsigned long long)(n < count ? n : count));
+    }
+    fprintf(f, "iovm_%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)count);
+    fprintf(f, "iovm_%s_sum %.9f\n", name, (double)iovm1_metrics_load(&h->sum) * 1e-9);
+    fprintf(f, "iovm_%s_count %llu\n", name, (unsigned long long)count);
+}
+
+int iovm1_metrics_write(struct iovm1_metrics_t *m, FILE *f) {
+    const struct iovm1_prof_t *p = &m->prof;
+    uint32_t n = __atomic_load_n(&m->n, __ATOMIC_ACQUIRE);
+
+    iovm1_metrics_header(f, "programs_loaded_total", "counter", "Programs loaded.");
+    fprintf(f, "iovm_programs_loaded_total %llu\n", (unsigned long long)iovm1_metrics_load(&m->programs_loaded));
+
+    iovm1_metrics_header(f, "programs_executed_total", "counter", "Programs which ended or errored.");
+    fprintf(f, "iovm_programs_executed_total %llu\n",
+        (unsigned long long)iovm1_metrics_load(&m->programs_executed));
+
+    iovm1_metrics_header(f, "errors_total", "counter", "Errors by enum iovm1_error.");
+    for (int i = 0; i < IOVM1_PROF_ERRORS; i++) {
+        uint64_t v = iovm1_metrics_load(&p->errors[i]);
+        if (v) {
+            fprintf(f, "iovm_errors_total{code=\"%d\"} %llu\n", i, (unsigned long long)v);
+        }
+    }
+
+    iovm1_metrics_header(f, "instructions_total", "counter", "Instructions started by opcode.");
+    for (int i = 0; i < IOVM1_PROF_OPCODES; i++) {
+        uint64_t v = iovm1_metrics_load(&p->inst_count[i]);
+        if (v) {
+            fprintf(f, "iovm_instructions_total{opcode=\"%s\"} %llu\n",
+                iovm1_opcode_name((enum iovm1_opcode)i),
+                (unsigned long long)v);
+        }
+    }
+
+    iovm1_metrics_header(f, "chip_read_bytes_total", "counter", "Bytes read per memory chip.");
+    for (int i = 0; i < IOVM1_PROF_CHIPS; i++) {
+        uint64_t v = iovm1_metrics_load(&p->chip_read[i]);
+        if (v) {
+            fprintf(f, "iovm_chip_read_bytes_total{chip=\"%d\"} %llu\n", i, (unsigned long long)v);
+        }
+    }
+
+    iovm1_metrics_header(f, "chip_written_bytes_total", "counter", "Bytes written per memory chip.");
+    for (int i = 0; i < IOVM1_PROF_CHIPS; i++) {
+        uint64_t v = iovm1_metrics_load(&p->chip_written[i]);
+        if (v) {
+            fprintf(f, "iovm_chip_written_bytes_total{chip=\"%d\"} %llu\n", i, (unsigned long long)v);
+        }
+    }
+
+    if (m->hists) {
+        iovm1_metrics_histogram(f, "program_seconds", "Program wall time.", &m->hists->program);
+        iovm1_metrics_histogram(f, "wait_seconds", "WAIT_UNTIL wall time.", &m->hists->wait);
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        const struct iovm1_metric_t *x = &m->m[i];
+        uint64_t v = iovm1_metrics_load(&x->v);
+        uint32_t j;
+
+        // one HELP and TYPE per metric name:
+        for (j = 0; j < i && strcmp(m->m[j].name, x->name) != 0; j++) {
+        }
+        if (j == i) {
+            iovm1_metrics_header(f, x->name, x->type == IOVM1_METRIC_COUNTER ? "counter" : "gauge", x->help);
+        }
+
+        fprintf(f, "iovm_%s", x->name);
+        if (x->labels) {
+            fprintf(f, "{%s}", x->labels);
+        }
+        if (x->type == IOVM1_METRIC_COUNTER) {
+            fprintf(f, " %llu\n", (unsigned long long)v);
+        } else {
+            double d;
+            memcpy(&d, &v, sizeof(d));
+            fprintf(f, " %.17g\n", d);
+        }
+    }
+
+    return ferror(f) ? -1 : 0;
+}
+
+int iovm1_metrics_write_file(struct iovm1_metrics_t *m, const char *path) {
+    size_t l = strlen(path);
+    char *tmp = (char *)malloc(l + 5);
+    FILE *f;
+    int r;
+
+    if (!tmp) {
+        return -1;
+    }
+    memcpy(tmp, path, l);
+    memcpy(tmp + l, ".tmp", 5);
+
+    if (!(f = fopen(tmp, "w"))) {
+        free(tmp);
+        return -1;
+    }
+    r = iovm1_metrics_write(m, f);
+    if (fclose(f) != 0) {
+        r = -1;
+    }
+
+    // rename() atomically replaces the previous file:
+    if (r == 0 && rename(tmp, path) != 0) {
+        r = -1;
+    }
+    if (r != 0) {
+        remove(tmp);
+    }
+
+    free(tmp);
+    return r;
+}
+
+static void *iovm1_metrics_writer_main(void *arg) {
+    struct iovm1_metrics_t *m = (struct iovm1_metrics_t *)arg;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&m->lock);
+    while (!m->stop) {
+        pthread_mutex_unlock(&m->lock);
+        iovm1_metrics_write_file(m, m->path);
+        pthread_mutex_lock(&m->lock);
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += m->interval_ms / 1000;
+        deadline.tv_nsec += (long)(m->interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!m->stop && pthread_cond_timedwait(&m->cond, &m->lock, &deadline) != ETIMEDOUT) {
+        }
+    }
+    pthread_mutex_unlock(&m->lock);
+
+    iovm1_metrics_write_file(m, m->path);
+    return 0;
+}
+
+int iovm1_metrics_writer_start(struct iovm1_metrics_t *m, const char *path, uint32_t interval_ms) {
+    m->path = path;
+    m->interval_ms = interval_ms;
+    m->stop = 0;
+
+    return pthread_create(&m->thread, 0, iovm1_metrics_writer_main, m) == 0 ? 0 : -1;
+}
+
+void iovm1_metrics_writer_stop(struct iovm1_metrics_t *m) {
+    pthread_mutex_lock(&m->lock);
+    m->stop = 1;
+    pthread_cond_signal(&m->cond);
+    pthread_mutex_unlock(&m->lock);
+
+    pthread_join(m->thread, 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
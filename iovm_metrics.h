@@ -0,0 +1,124 @@
+#ifndef IOVM_METRICS_H
+#define IOVM_METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    iovm_metrics.h: Prometheus text format metrics for iovm1 hosts
+
+    requires iovm.c to be compiled with IOVM1_USE_HOOKS. collects VM metrics from host_hook() and renders them,
+    together with any host-registered counters and gauges, in the Prometheus text exposition format. a background
+    thread periodically writes the text to a temporary file and rename()s it over the target path, so a scraper
+    such as the node exporter textfile collector never sees a partial file. the executor is never blocked: counters
+    it alone updates, including the iovm_prof.h counters, are advanced with relaxed atomic stores, host-registered
+    counters with atomic adds, and the writer only performs atomic loads.
+
+        static struct iovm1_metrics_t metrics;
+
+        iovm1_metrics_init(&metrics);
+        iovm1_metrics_attach_hists(&metrics, &hists);
+        hits = iovm1_metrics_add(&metrics, IOVM1_METRIC_COUNTER, "cache_hits_total", 0, "Cache hits.");
+        iovm1_metrics_writer_start(&metrics, "/var/lib/node_exporter/iovm.prom", 5000);
+
+        void host_hook(struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg) {
+            iovm1_metrics_hook(&metrics, vm, h, arg);
+        }
+
+    built-in metrics, all prefixed with "iovm_":
+        programs_loaded_total                       programs loaded
+        programs_executed_total                     programs which ended or errored
+        errors_total{code}                          errors by enum iovm1_error
+        instructions_total{opcode}                  instructions started by opcode
+        chip_read_bytes_total{chip}                 bytes read per memory chip
+        chip_written_bytes_total{chip}              bytes written per memory chip
+        program_seconds, wait_seconds               histograms, when iovm_hist histograms are attached
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "iovm.h"
+#include "iovm_prof.h"
+#include "iovm_hist.h"
+
+#define IOVM1_METRICS_MAX 64
+
+enum iovm1_metric_type {
+    IOVM1_METRIC_COUNTER,
+    IOVM1_METRIC_GAUGE,
+};
+
+// host-registered metric:
+struct iovm1_metric_t {
+    enum iovm1_metric_type type;
+    // name without the "iovm_" prefix:
+    const char *name;
+    // label pairs without braces, e.g. `cache="rom"`; 0 for none:
+    const char *labels;
+    const char *help;
+    // counter value, or gauge value as double bits:
+    uint64_t v;
+};
+
+struct iovm1_metrics_t {
+    struct iovm1_metric_t m[IOVM1_METRICS_MAX];
+    uint32_t n;
+
+    // built-in VM metrics; written only by the executor:
+    struct iovm1_prof_t prof;
+    uint64_t programs_loaded;
+    uint64_t programs_executed;
+
+    const struct iovm1_hists_t *hists;
+
+    // background writer:
+    const char *path;
+    uint32_t interval_ms;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stop;
+};
+
+void iovm1_metrics_init(struct iovm1_metrics_t *m);
+
+// exports the program and wait histograms; `hs` must be fed by the host's own iovm1_hists_hook() calls
+void iovm1_metrics_attach_hists(struct iovm1_metrics_t *m, const struct iovm1_hists_t *hs);
+
+// registers a host metric; returns 0 when full. strings must outlive the registry
+struct iovm1_metric_t *iovm1_metrics_add(
+    struct iovm1_metrics_t *m,
+    enum iovm1_metric_type type,
+    const char *name,
+    const char *labels,
+    const char *help
+);
+
+static inline void iovm1_metric_inc(struct iovm1_metric_t *x, uint64_t n) {
+    __atomic_fetch_add(&x->v, n, __ATOMIC_RELAXED);
+}
+
+void iovm1_metric_set(struct iovm1_metric_t *x, double v);
+
+void iovm1_metrics_hook(struct iovm1_metrics_t *m, struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg);
+
+// renders all metrics in Prometheus text format
+int iovm1_metrics_write(struct iovm1_metrics_t *m, FILE *f);
+
+// renders all metrics to `path`.tmp and renames it over `path`
+int iovm1_metrics_write_file(struct iovm1_metrics_t *m, const char *path);
+
+// starts a thread calling iovm1_metrics_write_file() every `interval_ms`
+int iovm1_metrics_writer_start(struct iovm1_metrics_t *m, const char *path, uint32_t interval_ms);
+
+// wakes and stops the writer thread after a final write
+void iovm1_metrics_writer_stop(struct iovm1_metrics_t *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //IOVM_METRICS_H
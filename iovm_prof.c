@@ -0,0 +1,189 @@
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "iovm_prof.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static const char *opcode_names[IOVM1_PROF_OPCODES] = {
+    [IOVM1_OPCODE_READ] = "READ",
+    [IOVM1_OPCODE_WRITE] = "WRITE",
+    [IOVM1_OPCODE_WAIT_UNTIL] = "WAIT_UNTIL",
+    [IOVM1_OPCODE_ABORT_UNLESS] = "ABORT_UNLESS",
+    [IOVM1_OPCODE_RMW] = "RMW",
+    [IOVM1_OPCODE_CAS] = "CAS",
+    [IOVM1_OPCODE_WRITE_VERIFY] = "WRITE_VERIFY",
+    [IOVM1_OPCODE_COMPARE] = "COMPARE",
+    [IOVM1_OPCODE_SEARCH] = "SEARCH",
+    [IOVM1_OPCODE_SKIP_UNLESS] = "SKIP_UNLESS",
+};
+
+static const char *host_names[IOVM1_HOOK_HOST_COUNT] = {
+    [IOVM1_HOOK_HOST_READ_STATE_MACHINE] = "read_state_machine",
+    [IOVM1_HOOK_HOST_WRITE_STATE_MACHINE] = "write_state_machine",
+    [IOVM1_HOOK_HOST_WAIT_STATE_MACHINE] = "wait_state_machine",
+    [IOVM1_HOOK_HOST_VERIFY_STATE_MACHINE] = "verify_state_machine",
+    [IOVM1_HOOK_HOST_SEARCH_STATE_MACHINE] = "search_state_machine",
+    [IOVM1_HOOK_HOST_TRY_READ_BYTE] = "try_read_byte",
+    [IOVM1_HOOK_HOST_TRY_WRITE_BYTE] = "try_write_byte",
+};
+
+const char *iovm1_opcode_name(enum iovm1_opcode o) {
+    if ((unsigned)o >= IOVM1_PROF_OPCODES || !opcode_names[o]) {
+        return "UNKNOWN";
+    }
+    return opcode_names[o];
+}
+
+const char *iovm1_hook_host_name(enum iovm1_hook_host h) {
+    if ((unsigned)h >= IOVM1_HOOK_HOST_COUNT) {
+        return "unknown";
+    }
+    return host_names[h];
+}
+
+uint64_t iovm1_prof_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// counters have a single writer, the executing thread; relaxed atomic stores let another thread such as the metrics
+// writer read them without a data race, and compile to plain stores:
+#define IOVM1_PROF_ADD(x, n) __atomic_store_n(&(x), (x) + (n), __ATOMIC_RELAXED)
+
+void iovm1_prof_init(struct iovm1_prof_t *prof) {
+    memset(prof, 0, sizeof(*prof));
+}
+
+// counts the bytes the instruction at `vm->p` transfers per memory chip:
+static void iovm1_prof_count_bytes(struct iovm1_prof_t *prof, struct iovm1_t *vm, enum iovm1_opcode o) {
+    const uint8_t *m = &vm->m.ptr[vm->p];
+    uint8_t c = m[1];
+    uint32_t l;
+
+    switch (o) {
+        case IOVM1_OPCODE_READ:
+        case IOVM1_OPCODE_COMPARE:
+            l = m[5] ? m[5] : 256;
+            IOVM1_PROF_ADD(prof->chip_read[c], l);
+            break;
+        case IOVM1_OPCODE_WRITE:
+            l = m[5] ? m[5] : 256;
+            IOVM1_PROF_ADD(prof->chip_written[c], l);
+            break;
+        case IOVM1_OPCODE_WRITE_VERIFY:
+            l = m[5] ? m[5] : 256;
+            IOVM1_PROF_ADD(prof->chip_written[c], l);
+            IOVM1_PROF_ADD(prof->chip_read[c], l);
+            break;
+        case IOVM1_OPCODE_WAIT_UNTIL:
+        case IOVM1_OPCODE_ABORT_UNLESS:
+        case IOVM1_OPCODE_SKIP_UNLESS:
+        case IOVM1_OPCODE_CAS:
+            IOVM1_PROF_ADD(prof->chip_read[c], 1);
+            break;
+        case IOVM1_OPCODE_RMW:
+            IOVM1_PROF_ADD(prof->chip_read[c], 1);
+            IOVM1_PROF_ADD(prof->chip_written[c], 1);
+            break;
+        case IOVM1_OPCODE_SEARCH:
+            l = (uint32_t)m[5] | ((uint32_t)m[6] << 8) | ((uint32_t)m[7] << 16);
+            IOVM1_PROF_ADD(prof->chip_read[c], l ? l : 1UL << 24);
+            break;
+        default:
+            break;
+    }
+}
+
+void iovm1_prof_hook(struct iovm1_prof_t *prof, struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg) {
+    uint64_t t = iovm1_prof_cycles();
+
+    switch (h) {
+        case IOVM1_HOOK_INST_START:
+            prof->inst_t0 = t;
+            IOVM1_PROF_ADD(prof->inst_count[arg & (IOVM1_PROF_OPCODES - 1)], 1);
+            iovm1_prof_count_bytes(prof, vm, (enum iovm1_opcode)arg);
+            break;
+        case IOVM1_HOOK_INST_END:
+            IOVM1_PROF_ADD(prof->inst_cycles[arg & (IOVM1_PROF_OPCODES - 1)], t - prof->inst_t0);
+            // CAS only writes when its comparison succeeds:
+            if (arg == IOVM1_OPCODE_CAS && vm->e == IOVM1_SUCCESS) {
+                IOVM1_PROF_ADD(prof->chip_written[vm->m.ptr[vm->p + 1]], 1);
+            }
+            break;
+        case IOVM1_HOOK_STATE:
+            IOVM1_PROF_ADD(prof->state_transitions, 1);
+            break;
+        case IOVM1_HOOK_HOST_ENTER:
+            prof->host_t0 = t;
+            break;
+        case IOVM1_HOOK_HOST_EXIT:
+            if (arg < IOVM1_HOOK_HOST_COUNT) {
+                IOVM1_PROF_ADD(prof->host_count[arg], 1);
+                IOVM1_PROF_ADD(prof->host_cycles[arg], t - prof->host_t0);
+            }
+            break;
+        case IOVM1_HOOK_ERROR:
+            IOVM1_PROF_ADD(prof->errors[arg & (IOVM1_PROF_ERRORS - 1)], 1);
+            break;
+    }
+}
+
+void iovm1_prof_dump(const struct iovm1_prof_t *prof, FILE *f) {
+    fprintf(f, "%-24s %12s %14s %10s\n", "opcode", "count", "cycles", "cyc/inst");
+    for (int i = 0; i < IOVM1_PROF_OPCODES; i++) {
+        if (!prof->inst_count[i]) {
+            continue;
+        }
+        fprintf(f, "%-24s %12llu %14llu %10.1f\n",
+            iovm1_opcode_name((enum iovm1_opcode)i),
+            (unsigned long long)prof->inst_count[i],
+            (unsigned long long)prof->inst_cycles[i],
+            (double)prof->inst_cycles[i] / (double)prof->inst_count[i]);
+    }
+
+    fprintf(f, "%-24s %12s %14s %10s\n", "host function", "calls", "cycles", "cyc/call");
+    for (int i = 0; i < IOVM1_HOOK_HOST_COUNT; i++) {
+        if (!prof->host_count[i]) {
+            continue;
+        }
+        fprintf(f, "%-24s %12llu %14llu %10.1f\n",
+            host_names[i],
+            (unsigned long long)prof->host_count[i],
+            (unsigned long long)prof->host_cycles[i],
+            (double)prof->host_cycles[i] / (double)prof->host_count[i]);
+    }
+
+    fprintf(f, "%-24s %12s %14s\n", "chip", "read", "written");
+    for (int i = 0; i < IOVM1_PROF_CHIPS; i++) {
+        if (!prof->chip_read[i] && !prof->chip_written[i]) {
+            continue;
+        }
+        fprintf(f, "%-24d %12llu %14llu\n",
+            i,
+            (unsigned long long)prof->chip_read[i],
+            (unsigned long long)prof->chip_written[i]);
+    }
+
+    for (int i = 0; i < IOVM1_PROF_ERRORS; i++) {
+        if (prof->errors[i]) {
+            fprintf(f, "error %-18d %12llu\n", i, (unsigned long long)prof->errors[i]);
+        }
+    }
+    fprintf(f, "state transitions        %12llu\n", (unsigned long long)prof->state_transitions);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,73 @@
+#ifndef IOVM_PROF_H
+#define IOVM_PROF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    iovm_prof.h: ready-made profiler for iovm1 execution hooks
+
+    requires iovm.c to be compiled with IOVM1_USE_HOOKS. the host forwards its host_hook() calls:
+
+        struct iovm1_prof_t prof;
+
+        void host_hook(struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg) {
+            iovm1_prof_hook(&prof, vm, h, arg);
+        }
+
+    instruction cycles cover the wall time from decode to completion, including any time spent outside of
+    iovm1_exec() between host state machine calls. cycles are read with rdtsc where available, else in nanoseconds
+    from clock_gettime(CLOCK_MONOTONIC).
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "iovm.h"
+
+#define IOVM1_PROF_OPCODES 32
+#define IOVM1_PROF_CHIPS 256
+#define IOVM1_PROF_ERRORS 16
+
+struct iovm1_prof_t {
+    // per opcode:
+    uint64_t inst_count[IOVM1_PROF_OPCODES];
+    uint64_t inst_cycles[IOVM1_PROF_OPCODES];
+
+    // per host function:
+    uint64_t host_count[IOVM1_HOOK_HOST_COUNT];
+    uint64_t host_cycles[IOVM1_HOOK_HOST_COUNT];
+
+    // per memory chip:
+    uint64_t chip_read[IOVM1_PROF_CHIPS];
+    uint64_t chip_written[IOVM1_PROF_CHIPS];
+
+    // per enum iovm1_error:
+    uint64_t errors[IOVM1_PROF_ERRORS];
+
+    uint64_t state_transitions;
+
+    // start of in-flight instruction and host call:
+    uint64_t inst_t0;
+    uint64_t host_t0;
+};
+
+void iovm1_prof_init(struct iovm1_prof_t *prof);
+
+void iovm1_prof_hook(struct iovm1_prof_t *prof, struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg);
+
+// writes a human-readable report of all non-zero counters
+void iovm1_prof_dump(const struct iovm1_prof_t *prof, FILE *f);
+
+uint64_t iovm1_prof_cycles(void);
+
+const char *iovm1_opcode_name(enum iovm1_opcode o);
+
+const char *iovm1_hook_host_name(enum iovm1_hook_host h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //IOVM_PROF_H
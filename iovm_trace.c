@@ -0,0 +1,151 @@
+#include <string.h>
+#include <time.h>
+
+#include "iovm_trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int iovm1_trace_init(struct iovm1_trace_t *tr, struct iovm1_trace_rec_t *buf, uint32_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return -1;
+    }
+
+    tr->buf = buf;
+    tr->mask = capacity - 1;
+    tr->dropped = 0;
+    tr->head = 0;
+    tr->tail = 0;
+
+    return 0;
+}
+
+uint64_t iovm1_trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void iovm1_trace_hook(struct iovm1_trace_t *tr, uint16_t vm_id, struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg) {
+    uint64_t head = tr->head;
+
+    if (head - __atomic_load_n(&tr->tail, __ATOMIC_ACQUIRE) > tr->mask) {
+        // full; never block the VM:
+        tr->dropped++;
+        return;
+    }
+
+    struct iovm1_trace_rec_t *r = &tr->buf[head & tr->mask];
+    r->t = iovm1_trace_now();
+    r->p = vm->p;
+    r->arg = arg;
+    r->vm = vm_id;
+    r->h = (uint8_t)h;
+    r->s = (uint8_t)vm->s;
+    r->e = (uint8_t)vm->e;
+    r->reserved = 0;
+
+    r->x = 0;
+    r->c = 0;
+    r->a = 0;
+    r->l = 0;
+    if (h == IOVM1_HOOK_INST_START) {
+        // decode common operands without reading past the end of an unverified program:
+        uint8_t m[6] = { 0 };
+        uint32_t n = vm->m.len - vm->p;
+        memcpy(m, &vm->m.ptr[vm->p], n < 6 ? n : 6);
+
+        r->x = m[0];
+        r->c = m[1];
+        r->a = (uint32_t)m[2] | ((uint32_t)m[3] << 8) | ((uint32_t)m[4] << 16);
+        r->l = m[5];
+    }
+
+    // publish:
+    __atomic_store_n(&tr->head, head + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t iovm1_trace_drain(struct iovm1_trace_t *tr, struct iovm1_trace_rec_t *out, uint32_t max) {
+    uint64_t tail = tr->tail;
+    uint64_t head = __atomic_load_n(&tr->head, __ATOMIC_ACQUIRE);
+    uint32_t n = 0;
+
+    while (tail != head && n < max) {
+        out[n++] = tr->buf[tail & tr->mask];
+        tail++;
+    }
+
+    // release the slots back to the producer:
+    __atomic_store_n(&tr->tail, tail, __ATOMIC_RELEASE);
+    return n;
+}
+
+int iovm1_trace_write_header(FILE *f) {
+    uint32_t hdr[2] = { sizeof(struct iovm1_trace_rec_t), 0 };
+
+    if (fwrite(IOVM1_TRACE_MAGIC, 8, 1, f) != 1) {
+        return -1;
+    }
+    if (fwrite(hdr, sizeof(hdr), 1, f) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+int iovm1_trace_read_header(FILE *f) {
+    char magic[8];
+    uint32_t hdr[2];
+
+    if (fread(magic, 8, 1, f) != 1 || memcmp(magic, IOVM1_TRACE_MAGIC, 8) != 0) {
+        return -1;
+    }
+    if (fread(hdr, sizeof(hdr), 1, f) != 1 || hdr[0] != sizeof(struct iovm1_trace_rec_t)) {
+        return -1;
+    }
+    return 0;
+}
+
+static void iovm1_trace_writer_flush(struct iovm1_trace_writer_t *w) {
+    struct iovm1_trace_rec_t recs[256];
+    uint32_t n;
+
+    while ((n = iovm1_trace_drain(w->tr, recs, 256)) > 0) {
+        fwrite(recs, sizeof(recs[0]), n, w->f);
+    }
+}
+
+static void *iovm1_trace_writer_main(void *arg) {
+    struct iovm1_trace_writer_t *w = (struct iovm1_trace_writer_t *)arg;
+    const struct timespec idle = { 0, 1000000 };
+
+    while (!__atomic_load_n(&w->stop, __ATOMIC_ACQUIRE)) {
+        iovm1_trace_writer_flush(w);
+        nanosleep(&idle, 0);
+    }
+    iovm1_trace_writer_flush(w);
+
+    return 0;
+}
+
+int iovm1_trace_writer_start(struct iovm1_trace_writer_t *w, struct iovm1_trace_t *tr, FILE *f) {
+    if (!f || iovm1_trace_write_header(f) != 0) {
+        return -1;
+    }
+
+    w->tr = tr;
+    w->f = f;
+    w->stop = 0;
+
+    return pthread_create(&w->thread, 0, iovm1_trace_writer_main, w) == 0 ? 0 : -1;
+}
+
+void iovm1_trace_writer_stop(struct iovm1_trace_writer_t *w) {
+    __atomic_store_n(&w->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(w->thread, 0);
+    fflush(w->f);
+}
+
+#ifdef __cplusplus
+}
+#endif
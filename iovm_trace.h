@@ -0,0 +1,115 @@
+#ifndef IOVM_TRACE_H
+#define IOVM_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    iovm_trace.h: lock-free binary execution trace for iovm1 execution hooks
+
+    requires iovm.c to be compiled with IOVM1_USE_HOOKS. each producer thread owns one `struct iovm1_trace_t` ring
+    buffer which may be shared by any number of VMs stepped on that thread; records carry a host-assigned VM id.
+    a single consumer drains the ring concurrently. the producer never blocks: when the ring is full the record is
+    dropped and counted in `dropped`.
+
+        static struct iovm1_trace_rec_t ring[4096];
+        static struct iovm1_trace_t trace;
+        static struct iovm1_trace_writer_t writer;
+
+        iovm1_trace_init(&trace, ring, 4096);
+        iovm1_trace_writer_start(&writer, &trace, fopen("vm.trace", "wb"));
+
+        void host_hook(struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg) {
+            iovm1_trace_hook(&trace, vm_id_of(vm), vm, h, arg);
+        }
+
+    trace file format (all fields in host byte order):
+        8 bytes     magic "IOVMTRC1"
+        4 bytes     record size in bytes
+        4 bytes     reserved, 0
+        ...         records
+
+    `iovm_tracedump` decodes trace files.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "iovm.h"
+
+#define IOVM1_TRACE_MAGIC "IOVMTRC1"
+
+// one fixed-size trace record:
+struct iovm1_trace_rec_t {
+    // CLOCK_MONOTONIC nanoseconds:
+    uint64_t t;
+    // vm->p:
+    uint32_t p;
+    // hook argument:
+    uint32_t arg;
+    // decoded 24-bit address of the instruction at vm->p, for INST_START:
+    uint32_t a;
+    // host-assigned VM id:
+    uint16_t vm;
+    // enum iovm1_hook:
+    uint8_t h;
+    // vm->s and vm->e after the event:
+    uint8_t s;
+    uint8_t e;
+    // instruction byte, memory chip and raw length byte of the instruction at vm->p, for INST_START:
+    uint8_t x;
+    uint8_t c;
+    uint8_t l;
+    uint32_t reserved;
+};
+
+// single-producer single-consumer ring buffer:
+struct iovm1_trace_t {
+    struct iovm1_trace_rec_t *buf;
+    uint32_t mask;
+    uint64_t dropped;
+
+    // written only by the producer:
+    uint64_t head __attribute__((aligned(64)));
+    // written only by the consumer:
+    uint64_t tail __attribute__((aligned(64)));
+};
+
+// consumer thread draining a ring to a trace file:
+struct iovm1_trace_writer_t {
+    struct iovm1_trace_t *tr;
+    FILE *f;
+    pthread_t thread;
+    int stop;
+};
+
+// `capacity` must be a power of two
+int iovm1_trace_init(struct iovm1_trace_t *tr, struct iovm1_trace_rec_t *buf, uint32_t capacity);
+
+uint64_t iovm1_trace_now(void);
+
+// producer side; call from host_hook()
+void iovm1_trace_hook(struct iovm1_trace_t *tr, uint16_t vm_id, struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg);
+
+// consumer side; copies up to `max` records into `out` and returns the number copied
+uint32_t iovm1_trace_drain(struct iovm1_trace_t *tr, struct iovm1_trace_rec_t *out, uint32_t max);
+
+// writes the trace file header
+int iovm1_trace_write_header(FILE *f);
+
+// reads and validates the trace file header
+int iovm1_trace_read_header(FILE *f);
+
+// starts a consumer thread that writes the header then drains `tr` to `f` until stopped
+int iovm1_trace_writer_start(struct iovm1_trace_writer_t *w, struct iovm1_trace_t *tr, FILE *f);
+
+// stops the consumer thread after a final drain and flushes `f`
+void iovm1_trace_writer_stop(struct iovm1_trace_writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //IOVM_TRACE_H
@@ -1,8 +1,18 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <assert.h>
 
 #include "iovm.h"
+#include "iovm_prof.h"
+#include "iovm_trace.h"
+#include "iovm_chrome.h"
+#include "iovm_hist.h"
+#include "iovm_metrics.h"
+#include "iovm_host.h"
 
 int tests_passed = 0;
 int tests_failed = 0;
@@ -23,6 +33,44 @@ struct fake {
 
     uint8_t l;
     uint8_t data[256];
+
+    // fake memory chips, 64 KiB each, addresses wrap:
+    uint8_t mem[8][0x10000];
+    // number of host_memory_try_read_byte() invocations:
+    int try_read_count;
+    // number of host_memory_try_write_byte() invocations:
+    int try_write_count;
+
+    // last verify result:
+    int verify_mismatches;
+    uint8_t verify_bitmap[32];
+    int verify_first_mismatch;
+
+    // last search result:
+    int search_count;
+    uint24_t search_found[256];
+
+    // fake clock advances by 1 on every read; wait state machine adds wait_ticks and a frame:
+    uint64_t clock;
+    int wait_ticks;
+    uint32_t frame;
+    // wait state machine continues this many times before completing:
+    int wait_rounds;
+
+    // last end message:
+    int end_count;
+    uint8_t end_summary[IOVM1_SUMMARY_SIZE];
+
+    // recorded hook events:
+    int hook_count;
+    struct {
+        enum iovm1_hook h;
+        uint32_t arg;
+    } hooks[64];
+    struct iovm1_prof_t prof;
+    struct iovm1_trace_t *trace;
+    struct iovm1_hists_t *hists;
+    struct iovm1_metrics_t *metrics;
 };
 
 struct fake fake_default = {};
@@ -33,6 +81,10 @@ void fake_reset(void) {
 }
 
 void fake_init_test(struct iovm1_t *vm) {
+    // detach any trace ring, histograms or metrics left over from a previous test:
+    fake_host.trace = 0;
+    fake_host.hists = 0;
+    fake_host.metrics = 0;
     iovm1_init(vm);
 }
 
@@ -65,12 +117,168 @@ uint8_t host_memory_read_no_advance(struct iovm1_t *vm) {
 void host_memory_write_auto_advance(struct iovm1_t *vm, uint8_t b) {
 }
 
+// fake memory chip access:
+enum iovm1_error fake_mem(enum iovm1_memory_chip c, uint24_t a, uint8_t **b) {
+    if ((unsigned)c >= 8) {
+        return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+    }
+    *b = &fake_host.mem[c][a & 0xFFFF];
+    return IOVM1_SUCCESS;
+}
+
+// reads are never acknowledged by the fake client so tests can observe the READ state:
+enum iovm1_error host_memory_read_state_machine(struct iovm1_t *vm) {
+    vm->rd.os = IOVM1_OPSTATE_CONTINUE;
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error host_memory_write_state_machine(struct iovm1_t *vm) {
+    enum iovm1_error e;
+    uint8_t *b;
+
+    while (vm->wr.l-- > 0) {
+        if ((e = fake_mem(vm->wr.c, vm->wr.a++, &b)) != IOVM1_SUCCESS) {
+            return e;
+        }
+        // writes to ROM are silently dropped like on real hardware:
+        if (vm->wr.c == MEM_SNES_ROM) {
+            vm->wr.p++;
+            continue;
+        }
+        *b = vm->m.ptr[vm->wr.p++];
+    }
+    vm->wr.os = IOVM1_OPSTATE_COMPLETED;
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error host_memory_verify_state_machine(struct iovm1_t *vm) {
+    enum iovm1_error e;
+    uint8_t dm[256];
+    uint8_t *b;
+
+    for (int i = 0; i < vm->vf.l; i++) {
+        if ((e = fake_mem(vm->vf.c, vm->vf.a + i, &b)) != IOVM1_SUCCESS) {
+            return e;
+        }
+        dm[i] = *b;
+    }
+    if (vm->vf.r == IOVM1_COMPARE_REPLY_FIRST_MISMATCH) {
+        fake_host.verify_first_mismatch = iovm1_memory_first_mismatch(&vm->m.ptr[vm->vf.p], dm, vm->vf.l);
+    } else {
+        fake_host.verify_mismatches = iovm1_memory_mismatch(&vm->m.ptr[vm->vf.p], dm, vm->vf.l, fake_host.verify_bitmap);
+    }
+    vm->vf.os = IOVM1_OPSTATE_COMPLETED;
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error host_memory_search_state_machine(struct iovm1_t *vm) {
+    const uint8_t *k = vm->sr.k ? &vm->m.ptr[vm->sr.k] : 0;
+    const uint8_t *h;
+    uint32_t hl;
+
+    if ((unsigned)vm->sr.c >= 8) {
+        return IOVM1_ERROR_MEMORY_CHIP_UNDEFINED;
+    }
+    if (vm->sr.a + vm->sr.l > 0x10000) {
+        return IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE;
+    }
+
+    h = &fake_host.mem[vm->sr.c][vm->sr.a];
+    hl = vm->sr.l;
+    fake_host.search_count = 0;
+    while (fake_host.search_count < vm->sr.m) {
+        uint32_t i = iovm1_memory_search(h, hl, &vm->m.ptr[vm->sr.p], k, vm->sr.n);
+        if (i == hl) {
+            break;
+        }
+        fake_host.search_found[fake_host.search_count++] = (uint24_t)(h + i - fake_host.mem[vm->sr.c]);
+        h += i + 1;
+        hl -= i + 1;
+    }
+
+    vm->sr.os = IOVM1_OPSTATE_COMPLETED;
+    return IOVM1_SUCCESS;
+}
+
+// fake wait tests the byte once and completes regardless of the result:
+enum iovm1_error host_memory_wait_state_machine(struct iovm1_t *vm) {
+    enum iovm1_error e;
+    uint8_t *b;
+
+    if ((e = fake_mem(vm->wa.c, vm->wa.a, &b)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    (void) iovm1_memory_wait_test_byte(vm, *b);
+    if (fake_host.wait_rounds > 0) {
+        fake_host.wait_rounds--;
+        vm->wa.os = IOVM1_OPSTATE_CONTINUE;
+        return IOVM1_SUCCESS;
+    }
+    fake_host.clock += fake_host.wait_ticks;
+    fake_host.frame += fake_host.wait_ticks != 0;
+    vm->wa.os = IOVM1_OPSTATE_COMPLETED;
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error host_memory_try_read_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t *b) {
+    enum iovm1_error e;
+    uint8_t *m;
+
+    fake_host.try_read_count++;
+    if ((e = fake_mem(c, a, &m)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    *b = *m;
+    return IOVM1_SUCCESS;
+}
+
+enum iovm1_error host_memory_try_write_byte(struct iovm1_t *vm, enum iovm1_memory_chip c, uint24_t a, uint8_t b) {
+    enum iovm1_error e;
+    uint8_t *m;
+
+    fake_host.try_write_count++;
+    if ((e = fake_mem(c, a, &m)) != IOVM1_SUCCESS) {
+        return e;
+    }
+    *m = b;
+    return IOVM1_SUCCESS;
+}
+
 // send an abort message to the client
 void host_send_abort(struct iovm1_t *vm) {}
 // send a read-complete message to the client with the fully read data up to 256 bytes in length
 void host_send_read(struct iovm1_t *vm, uint8_t l, uint8_t *d) {}
 // send a program-end message to the client
-void host_send_end(struct iovm1_t *vm) {}
+void host_send_end(struct iovm1_t *vm) {
+    fake_host.end_count++;
+    iovm1_summary_pack(vm, fake_host.end_summary);
+}
+
+void host_hook(struct iovm1_t *vm, enum iovm1_hook h, uint32_t arg) {
+    if (fake_host.hook_count < 64) {
+        fake_host.hooks[fake_host.hook_count].h = h;
+        fake_host.hooks[fake_host.hook_count].arg = arg;
+        fake_host.hook_count++;
+    }
+    iovm1_prof_hook(&fake_host.prof, vm, h, arg);
+    if (fake_host.trace) {
+        iovm1_trace_hook(fake_host.trace, 7, vm, h, arg);
+    }
+    if (fake_host.hists) {
+        iovm1_hists_hook(fake_host.hists, vm, h, arg);
+    }
+    if (fake_host.metrics) {
+        iovm1_metrics_hook(fake_host.metrics, vm, h, arg);
+    }
+}
+
+uint64_t host_clock_now(struct iovm1_t *vm) {
+    return fake_host.clock++;
+}
+
+uint32_t host_frame_counter(struct iovm1_t *vm) {
+    return fake_host.frame;
+}
 
 // initialize a host-side countdown timer to a timeout value for WAIT operation, e.g. duration of a single video frame
 void host_timer_reset(struct iovm1_t *vm) {}
@@ -215,6 +423,1787 @@ int test_reset_retry(struct iovm1_t *vm) {
     return 0;
 }
 
+int test_rmw(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_RMW(IOVM1_ALU_OR),
+        MEM_SNES_WRAM,
+        0x10,
+        0xF3,
+        0x7E,
+        0x81,   // operand
+        0x0F,   // mask
+        IOVM1_MK_RMW(IOVM1_ALU_ADD),
+        MEM_SNES_WRAM,
+        0x11,
+        0xF3,
+        0x7E,
+        0x02,   // operand
+        0xFF,   // mask
+    };
+
+    fake_init_test(vm);
+    fake_host.mem[MEM_SNES_WRAM][0xF310] = 0x40;
+    fake_host.mem[MEM_SNES_WRAM][0xF311] = 0xFF;
+
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    // OR only within the mask:
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_EXECUTE_NEXT, iovm1_get_exec_state(vm), "state");
+    VERIFY_EQ_INT(0x41, fake_host.mem[MEM_SNES_WRAM][0xF310], "memory");
+
+    // ADD wraps:
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(0x01, fake_host.mem[MEM_SNES_WRAM][0xF311], "memory");
+
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ENDED, iovm1_get_exec_state(vm), "state");
+    VERIFY_EQ_INT(2, fake_host.try_write_count, "host_memory_try_write_byte() invocations");
+
+    // an undefined operator fails without reading memory:
+    fake_init_test(vm);
+    fake_host.try_read_count = 0;
+    fake_host.try_write_count = 0;
+    proc[0] = IOVM1_MK_RMW(IOVM1_ALU_ADD + 1);
+    iovm1_load(vm, proc, sizeof(proc));
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_UNKNOWN_OPCODE, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ERRORED, iovm1_get_exec_state(vm), "state");
+    VERIFY_EQ_INT(0, fake_host.try_read_count, "host_memory_try_read_byte() invocations");
+    VERIFY_EQ_INT(0, fake_host.try_write_count, "host_memory_try_write_byte() invocations");
+
+    return 0;
+}
+
+int test_cas(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_CAS(IOVM1_CMP_EQ),
+        MEM_SNES_SRAM,
+        0x00,
+        0x00,
+        0x70,
+        0x00,   // expected
+        0xFF,   // mask
+        0x2A,   // new value
+        IOVM1_MK_CAS(IOVM1_CMP_EQ),
+        MEM_SNES_SRAM,
+        0x00,
+        0x00,
+        0x70,
+        0x00,   // expected
+        0xFF,   // mask
+        0x55,   // new value
+    };
+
+    fake_init_test(vm);
+
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    // compare succeeds and swaps:
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(0x2A, fake_host.mem[MEM_SNES_SRAM][0x0000], "memory");
+
+    // compare fails and aborts without writing:
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_ABORTED, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ERRORED, iovm1_get_exec_state(vm), "state");
+    VERIFY_EQ_INT(0x2A, fake_host.mem[MEM_SNES_SRAM][0x0000], "memory");
+    VERIFY_EQ_INT(8, vm->p, "failing instruction offset");
+    VERIFY_EQ_INT(1, fake_host.try_write_count, "host_memory_try_write_byte() invocations");
+
+    return 0;
+}
+
+int test_write_verify(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_WRITE_VERIFY(IOVM1_COMPARE_REPLY_BITMAP),
+        MEM_SNES_SRAM,
+        0x00,
+        0x00,
+        0x70,
+        0x02,
+        0xAA,
+        0x55,
+        IOVM1_MK_WRITE_VERIFY(IOVM1_COMPARE_REPLY_BITMAP),
+        MEM_SNES_ROM,
+        0x00,
+        0x80,
+        0x00,
+        0x03,
+        0x00,
+        0x12,
+        0x00,
+    };
+
+    fake_init_test(vm);
+
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    // write and verify both complete in one execution; ROM write is dropped:
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ENDED, iovm1_get_exec_state(vm), "state");
+    VERIFY_EQ_INT(0x55, fake_host.mem[MEM_SNES_SRAM][0x0001], "memory");
+
+    // only the middle byte of the ROM write mismatches:
+    VERIFY_EQ_INT(1, fake_host.verify_mismatches, "mismatches");
+    VERIFY_EQ_INT(0x02, fake_host.verify_bitmap[0], "mismatch bitmap");
+
+    return 0;
+}
+
+int test_compare(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[6 + 256 + 6 + 40] = {
+        IOVM1_MK_COMPARE(IOVM1_COMPARE_REPLY_BITMAP),
+        MEM_SNES_ROM,
+        0x00,
+        0x00,
+        0x00,
+        0x00,
+    };
+    uint8_t *p;
+
+    fake_init_test(vm);
+
+    // 256 bytes expected to match ROM contents except bytes 17 and 200:
+    for (int i = 0; i < 256; i++) {
+        fake_host.mem[MEM_SNES_ROM][i] = (uint8_t)(i * 7);
+        proc[6 + i] = (uint8_t)(i * 7);
+    }
+    proc[6 + 17] ^= 0x01;
+    proc[6 + 200] ^= 0x80;
+
+    // 40 bytes expected to match except byte 33:
+    p = &proc[6 + 256];
+    *p++ = IOVM1_MK_COMPARE(IOVM1_COMPARE_REPLY_FIRST_MISMATCH);
+    *p++ = MEM_SNES_ROM;
+    *p++ = 0x00;
+    *p++ = 0x00;
+    *p++ = 0x00;
+    *p++ = 40;
+    for (int i = 0; i < 40; i++) {
+        p[i] = (uint8_t)(i * 7);
+    }
+    p[33] = 0;
+
+    r = iovm1_load(vm, proc, (unsigned)(p + 40 - proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ENDED, iovm1_get_exec_state(vm), "state");
+
+    VERIFY_EQ_INT(2, fake_host.verify_mismatches, "mismatches");
+    VERIFY_EQ_INT(0x02, fake_host.verify_bitmap[17 >> 3], "mismatch bitmap");
+    VERIFY_EQ_INT(0x01, fake_host.verify_bitmap[200 >> 3], "mismatch bitmap");
+    VERIFY_EQ_INT(33, fake_host.verify_first_mismatch, "first mismatch");
+
+    return 0;
+}
+
+int test_search(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_SEARCH(0),
+        MEM_SNES_WRAM,
+        0x00,
+        0x00,
+        0x00,
+        0x00,   // length 0x8000
+        0x80,
+        0x00,
+        0x03,   // pattern length
+        0x00,   // max matches
+        0xDE,
+        0xAD,
+        0xBE,
+    };
+    uint8_t proc_masked[] = {
+        IOVM1_MK_SEARCH(1),
+        MEM_SNES_WRAM,
+        0x00,
+        0x00,
+        0x00,
+        0x00,   // length 0x8000
+        0x80,
+        0x00,
+        0x02,   // pattern length
+        0x02,   // max matches
+        0xA0,
+        0x05,
+        0xF0,   // mask
+        0xFF,
+    };
+
+    fake_init_test(vm);
+    memcpy(&fake_host.mem[MEM_SNES_WRAM][0x0123], "\xDE\xAD\xBE", 3);
+    memcpy(&fake_host.mem[MEM_SNES_WRAM][0x4567], "\xDE\xAD\xBE\xEF", 4);
+    memcpy(&fake_host.mem[MEM_SNES_WRAM][0x7FFE], "\xDE\xAD\xBE", 3);
+    memcpy(&fake_host.mem[MEM_SNES_WRAM][0x1000], "\xAB\x05", 2);
+    memcpy(&fake_host.mem[MEM_SNES_WRAM][0x2000], "\xA5\x05", 2);
+    memcpy(&fake_host.mem[MEM_SNES_WRAM][0x3000], "\xA5\x05", 2);
+
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ENDED, iovm1_get_exec_state(vm), "state");
+
+    // pattern straddling the range end is not a match:
+    VERIFY_EQ_INT(2, fake_host.search_count, "search matches");
+    VERIFY_EQ_INT(0x0123, fake_host.search_found[0], "search match address");
+    VERIFY_EQ_INT(0x4567, fake_host.search_found[1], "search match address");
+
+    fake_init_test(vm);
+
+    r = iovm1_load(vm, proc_masked, sizeof(proc_masked));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ENDED, iovm1_get_exec_state(vm), "state");
+
+    // bounded to 2 matches:
+    VERIFY_EQ_INT(2, fake_host.search_count, "search matches");
+    VERIFY_EQ_INT(0x1000, fake_host.search_found[0], "search match address");
+    VERIFY_EQ_INT(0x2000, fake_host.search_found[1], "search match address");
+
+    return 0;
+}
+
+// reference implementation of comparison operators:
+bool ref_memory_test(enum iovm1_cmp_operator q, uint8_t x, uint8_t v, uint8_t k) {
+    switch (q) {
+        case IOVM1_CMP_EQ: return (x & k) == v;
+        case IOVM1_CMP_NEQ: return (x & k) != v;
+        case IOVM1_CMP_LT: return (x & k) < v;
+        case IOVM1_CMP_NLT: return (x & k) >= v;
+        case IOVM1_CMP_GT: return (x & k) > v;
+        case IOVM1_CMP_NGT: return (x & k) <= v;
+        case IOVM1_CMP_IN: return v <= x && x <= k;
+        case IOVM1_CMP_NIN: return !(v <= x && x <= k);
+        default: return false;
+    }
+}
+
+int test_cmp_operators(struct iovm1_t *vm) {
+    const uint8_t masks[] = { 0x00, 0x01, 0x0F, 0x80, 0xF0, 0xFF };
+
+    for (int q = 0; q < 8; q++) {
+        for (int x = 0; x < 256; x++) {
+            for (int v = 0; v < 256; v++) {
+                for (int i = 0; i < sizeof(masks); i++) {
+                    uint8_t k = masks[i];
+                    VERIFY_EQ_INT(
+                        ref_memory_test(q, x, v, k),
+                        iovm1_memory_test(q, x, v, k),
+                        "iovm1_memory_test() return value"
+                    );
+                }
+                VERIFY_EQ_INT(
+                    q < IOVM1_CMP_IN && ref_memory_test(q, x, v, 0xFF),
+                    iovm1_memory_cmp(q, x, v),
+                    "iovm1_memory_cmp() return value"
+                );
+            }
+        }
+    }
+
+    return 0;
+}
+
+int test_abort_unless_in_range(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_ABORT_UNLESS(IOVM1_CMP_IN),
+        MEM_SNES_WRAM,
+        0x10,
+        0x00,
+        0x7E,
+        0x06,   // lower bound
+        0x09,   // upper bound
+    };
+
+    fake_init_test(vm);
+    fake_host.mem[MEM_SNES_WRAM][0x0010] = 0x09;
+
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    // in range:
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ENDED, iovm1_get_exec_state(vm), "state");
+
+    // out of range:
+    fake_host.mem[MEM_SNES_WRAM][0x0010] = 0x0A;
+    r = iovm1_exec_reset(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec_reset() return value");
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_ABORTED, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ERRORED, iovm1_get_exec_state(vm), "state");
+
+    return 0;
+}
+
+int test_skip_unless(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        // if flag == 1:
+        IOVM1_MK_SKIP_UNLESS(IOVM1_CMP_EQ),
+        MEM_SNES_WRAM,
+        0x00,
+        0x01,
+        0x7E,
+        0x01,
+        0xFF,
+        0x07,   // skip distance
+        0x00,
+        //   write 0x11:
+        IOVM1_OPCODE_WRITE,
+        MEM_SNES_WRAM,
+        0x01,
+        0x01,
+        0x7E,
+        0x01,
+        0x11,
+        // else:
+        IOVM1_MK_SKIP_UNLESS(IOVM1_CMP_NEQ),
+        MEM_SNES_WRAM,
+        0x00,
+        0x01,
+        0x7E,
+        0x01,
+        0xFF,
+        0x07,   // skip distance
+        0x00,
+        //   write 0x22:
+        IOVM1_OPCODE_WRITE,
+        MEM_SNES_WRAM,
+        0x01,
+        0x01,
+        0x7E,
+        0x01,
+        0x22,
+    };
+
+    for (int flag = 0; flag < 2; flag++) {
+        fake_reset();
+        fake_init_test(vm);
+        fake_host.mem[MEM_SNES_WRAM][0x0100] = flag;
+
+        r = iovm1_load(vm, proc, sizeof(proc));
+        VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+        r = iovm1_verify(vm);
+        VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_verify() return value");
+
+        while (iovm1_get_exec_state(vm) < IOVM1_STATE_ENDED) {
+            r = iovm1_exec(vm);
+            VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+        }
+
+        VERIFY_EQ_INT(IOVM1_STATE_ENDED, iovm1_get_exec_state(vm), "state");
+        VERIFY_EQ_INT(flag ? 0x11 : 0x22, fake_host.mem[MEM_SNES_WRAM][0x0101], "memory");
+    }
+
+    return 0;
+}
+
+int test_verify(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_SKIP_UNLESS(IOVM1_CMP_EQ),
+        MEM_SNES_WRAM,
+        0x00,
+        0x01,
+        0x7E,
+        0x01,
+        0xFF,
+        0x07,   // skip distance
+        0x00,
+        IOVM1_OPCODE_WRITE,
+        MEM_SNES_WRAM,
+        0x01,
+        0x01,
+        0x7E,
+        0x01,
+        0x11,
+    };
+
+    // skip to end of program is valid:
+    fake_init_test(vm);
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_verify() return value");
+
+    // skip into the middle of an instruction is not:
+    proc[7] = 0x03;
+    fake_init_test(vm);
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_OUT_OF_RANGE, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(0, vm->p, "failing instruction offset");
+
+    // truncated instruction:
+    proc[7] = 0x07;
+    fake_init_test(vm);
+    r = iovm1_load(vm, proc, sizeof(proc) - 1);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_OUT_OF_RANGE, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(9, vm->p, "failing instruction offset");
+
+    // undefined opcode:
+    proc[9] = IOVM1_MK(31, 0);
+    fake_init_test(vm);
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_UNKNOWN_OPCODE, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(9, vm->p, "failing instruction offset");
+
+    return 0;
+}
+
+uint32_t unpack_le(const uint8_t *d, int n) {
+    uint32_t v = 0;
+    for (int i = n - 1; i >= 0; i--) {
+        v = (v << 8) | d[i];
+    }
+    return v;
+}
+
+int test_chip_table(struct iovm1_t *vm) {
+    static const struct iovm1_chip_t chips[4] = {
+        [MEM_SNES_WRAM] = { 0x20000, IOVM1_CHIP_READABLE | IOVM1_CHIP_WRITABLE },
+        [MEM_SNES_VRAM] = { 0x10000, IOVM1_CHIP_READABLE | IOVM1_CHIP_WRITABLE | IOVM1_CHIP_WRAP },
+        [MEM_SNES_CGRAM] = { 0, 0 },
+        [MEM_SNES_OAM] = { 0x220, IOVM1_CHIP_READABLE },
+    };
+    uint8_t write_oam[] = {
+        IOVM1_OPCODE_WRITE, MEM_SNES_OAM, 0x00, 0x00, 0x00, 0x01, 0xAA,
+    };
+    uint8_t read_past_end[] = {
+        IOVM1_OPCODE_READ, MEM_SNES_WRAM, 0xFF, 0xFF, 0x01, 0x02,
+    };
+    uint8_t read_wrap[] = {
+        IOVM1_OPCODE_READ, MEM_SNES_VRAM, 0xFF, 0xFF, 0x00, 0x10,
+    };
+    uint8_t rmw_oam[] = {
+        IOVM1_OPCODE_READ, MEM_SNES_WRAM, 0x00, 0x00, 0x00, 0x01,
+        IOVM1_MK_RMW(IOVM1_ALU_OR), MEM_SNES_OAM, 0x00, 0x00, 0x00, 0x01, 0xFF,
+    };
+    uint8_t search_oam[] = {
+        IOVM1_MK_SEARCH(0), MEM_SNES_OAM, 0x00, 0x00, 0x00, 0x21, 0x02, 0x00, 0x01, 0x01, 0x55,
+    };
+    uint8_t undefined[] = {
+        IOVM1_MK_ABORT_UNLESS(IOVM1_CMP_EQ), MEM_SNES_CGRAM, 0x00, 0x00, 0x00, 0x00, 0xFF,
+        IOVM1_MK_ABORT_UNLESS(IOVM1_CMP_EQ), MEM_SNES_ROM, 0x00, 0x00, 0x00, 0x00, 0xFF,
+    };
+    uint8_t rmw_wram[] = {
+        IOVM1_MK_RMW(IOVM1_ALU_OR), MEM_SNES_WRAM, 0xFF, 0xFF, 0x01, 0x01, 0xFF,
+    };
+    int r;
+
+    // writes to a read-only chip fail at decode without reaching the host:
+    fake_init_test(vm);
+    iovm1_set_chips(vm, chips, 4);
+    iovm1_load(vm, write_oam, sizeof(write_oam));
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_NOT_WRITABLE, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ERRORED, iovm1_get_exec_state(vm), "state");
+    VERIFY_EQ_INT(0, fake_host.mem[MEM_SNES_OAM][0], "memory");
+    VERIFY_EQ_INT(1, fake_host.end_count, "host_send_end() invocations");
+
+    // the whole range must fit:
+    fake_init_test(vm);
+    iovm1_set_chips(vm, chips, 4);
+    iovm1_load(vm, read_past_end, sizeof(read_past_end));
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "iovm1_exec() return value");
+
+    // unless the chip wraps:
+    fake_init_test(vm);
+    iovm1_set_chips(vm, chips, 4);
+    iovm1_load(vm, read_wrap, sizeof(read_wrap));
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_READ, iovm1_get_exec_state(vm), "state");
+
+    // RMW needs both access rights:
+    fake_init_test(vm);
+    iovm1_set_chips(vm, chips, 4);
+    iovm1_load(vm, rmw_oam, sizeof(rmw_oam));
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_NOT_WRITABLE, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(6, vm->p, "failing instruction offset");
+
+    // SEARCH range past the end:
+    fake_init_test(vm);
+    iovm1_set_chips(vm, chips, 4);
+    iovm1_load(vm, search_oam, sizeof(search_oam));
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "iovm1_verify() return value");
+
+    // chips with size 0 or beyond the table are undefined:
+    fake_init_test(vm);
+    iovm1_set_chips(vm, chips, 4);
+    iovm1_load(vm, undefined, sizeof(undefined));
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_UNDEFINED, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(0, vm->p, "failing instruction offset");
+    undefined[2] = 0xFF;
+    undefined[1] = MEM_SNES_WRAM;
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_UNDEFINED, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(7, vm->p, "failing instruction offset");
+
+    // a verified program runs without decode checks; the last WRAM byte is in range:
+    fake_init_test(vm);
+    iovm1_set_chips(vm, chips, 4);
+    iovm1_load(vm, rmw_wram, sizeof(rmw_wram));
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(1, vm->access_verified, "access verified");
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(0x01, fake_host.mem[MEM_SNES_WRAM][0xFFFF], "memory");
+
+    // registering another table requires verifying again:
+    iovm1_set_chips(vm, chips, 1);
+    VERIFY_EQ_INT(0, vm->access_verified, "access verified");
+
+    return 0;
+}
+
+int test_acl(struct iovm1_t *vm) {
+    uint64_t wram_r[IOVM1_ACL_WORDS(0x20000)] = {0};
+    uint64_t wram_w[IOVM1_ACL_WORDS(0x20000)] = {0};
+    struct iovm1_acl_chip_t acl[] = {
+        [MEM_SNES_WRAM] = { wram_r, wram_w, IOVM1_ACL_PAGES(0x20000) },
+        [MEM_SNES_VRAM] = { 0, 0, 0 },
+    };
+    uint8_t read_granted[] = {
+        IOVM1_OPCODE_READ, MEM_SNES_WRAM, 0x80, 0x10, 0x00, 0x00,
+    };
+    uint8_t read_straddle[] = {
+        IOVM1_OPCODE_READ, MEM_SNES_WRAM, 0xF0, 0x11, 0x00, 0x20,
+    };
+    uint8_t rmw_read_only[] = {
+        IOVM1_OPCODE_READ, MEM_SNES_WRAM, 0x00, 0x10, 0x00, 0x01,
+        IOVM1_MK_RMW(IOVM1_ALU_OR), MEM_SNES_WRAM, 0x00, 0x10, 0x00, 0x01, 0xFF,
+    };
+    uint8_t rmw_granted[] = {
+        IOVM1_MK_RMW(IOVM1_ALU_OR), MEM_SNES_WRAM, 0x00, 0x20, 0x00, 0x01, 0xFF,
+    };
+    uint8_t read_unlisted[] = {
+        IOVM1_OPCODE_READ, MEM_SNES_VRAM, 0x00, 0x00, 0x00, 0x01,
+        IOVM1_OPCODE_READ, MEM_SNES_ARAM, 0x00, 0x00, 0x00, 0x01,
+    };
+    int r;
+
+    // reads of $1000-$11FF, writes of $2000-$20FF:
+    iovm1_acl_grant(wram_r, IOVM1_ACL_PAGES(0x20000), 0x1000, 0x200);
+    iovm1_acl_grant(wram_r, IOVM1_ACL_PAGES(0x20000), 0x2000, 0x100);
+    iovm1_acl_grant(wram_w, IOVM1_ACL_PAGES(0x20000), 0x2000, 0x100);
+    VERIFY_EQ_INT(1, iovm1_acl_test(wram_r, IOVM1_ACL_PAGES(0x20000), 0x1000, 0x200), "iovm1_acl_test()");
+    VERIFY_EQ_INT(0, iovm1_acl_test(wram_r, IOVM1_ACL_PAGES(0x20000), 0x0FFF, 2), "iovm1_acl_test()");
+    VERIFY_EQ_INT(0, iovm1_acl_test(wram_r, IOVM1_ACL_PAGES(0x20000), 0x1000, 0x1001), "iovm1_acl_test()");
+    VERIFY_EQ_INT(0, iovm1_acl_test(wram_r, IOVM1_ACL_PAGES(0x20000), 0x1FFFF, 2), "iovm1_acl_test()");
+
+    // ranges spanning bitmap words:
+    iovm1_acl_grant(wram_r, IOVM1_ACL_PAGES(0x20000), 0x3F00, 0x8200);
+    VERIFY_EQ_INT(1, iovm1_acl_test(wram_r, IOVM1_ACL_PAGES(0x20000), 0x3F80, 0x8100), "iovm1_acl_test()");
+    iovm1_acl_revoke(wram_r, IOVM1_ACL_PAGES(0x20000), 0x8000, 1);
+    VERIFY_EQ_INT(0, iovm1_acl_test(wram_r, IOVM1_ACL_PAGES(0x20000), 0x3F80, 0x8100), "iovm1_acl_test()");
+    VERIFY_EQ_INT(1, iovm1_acl_test(wram_r, IOVM1_ACL_PAGES(0x20000), 0x8100, 0x4000), "iovm1_acl_test()");
+
+    // a granted read of 256 bytes reaches the host:
+    fake_init_test(vm);
+    iovm1_set_acl(vm, acl, 2);
+    iovm1_load(vm, read_granted, sizeof(read_granted));
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_READ, iovm1_get_exec_state(vm), "state");
+
+    // a range straddling into a denied page fails at decode without reaching the host:
+    fake_init_test(vm);
+    iovm1_set_acl(vm, acl, 2);
+    iovm1_load(vm, read_straddle, sizeof(read_straddle));
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_ACCESS_DENIED, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ERRORED, iovm1_get_exec_state(vm), "state");
+    VERIFY_EQ_INT(1, fake_host.end_count, "host_send_end() invocations");
+
+    // RMW needs both permissions:
+    fake_init_test(vm);
+    iovm1_set_acl(vm, acl, 2);
+    iovm1_load(vm, rmw_read_only, sizeof(rmw_read_only));
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_ACCESS_DENIED, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(6, vm->p, "failing instruction offset");
+
+    // chips without bitmaps or beyond the ACL are denied:
+    fake_init_test(vm);
+    iovm1_set_acl(vm, acl, 2);
+    iovm1_load(vm, read_unlisted, sizeof(read_unlisted));
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_ACCESS_DENIED, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(0, vm->p, "failing instruction offset");
+    read_unlisted[1] = MEM_SNES_WRAM;
+    read_unlisted[3] = 0x10;
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_ACCESS_DENIED, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(6, vm->p, "failing instruction offset");
+
+    // a verified program runs without decode checks:
+    fake_init_test(vm);
+    iovm1_set_acl(vm, acl, 2);
+    iovm1_load(vm, rmw_granted, sizeof(rmw_granted));
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_verify() return value");
+    VERIFY_EQ_INT(1, vm->access_verified, "access verified");
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(0x01, fake_host.mem[MEM_SNES_WRAM][0x2000], "memory");
+
+    // the chip table is checked before the ACL:
+    fake_init_test(vm);
+    iovm1_set_acl(vm, acl, 2);
+    {
+        struct iovm1_chip_t chips[] = {
+            [MEM_SNES_WRAM] = { 0x20000, IOVM1_CHIP_READABLE },
+        };
+        iovm1_set_chips(vm, chips, 1);
+        iovm1_load(vm, rmw_granted, sizeof(rmw_granted));
+        r = iovm1_verify(vm);
+        VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_NOT_WRITABLE, r, "iovm1_verify() return value");
+    }
+
+    return 0;
+}
+
+int test_checkpoint(struct iovm1_t *vm) {
+    uint8_t proc[] = {
+        IOVM1_MK_WAIT_UNTIL(IOVM1_CMP_EQ), MEM_SNES_WRAM, 0x10, 0x00, 0x00, 0x00, 0xFF,
+        IOVM1_OPCODE_WRITE, MEM_SNES_WRAM, 0x20, 0x00, 0x00, 0x02, 0xAA, 0xBB,
+        IOVM1_OPCODE_READ, MEM_SNES_WRAM, 0x30, 0x00, 0x00, 0x04,
+    };
+    // a WRITE to $0000 whose data decodes as a WRITE to $1000:
+    uint8_t hidden[] = {
+        IOVM1_OPCODE_WRITE, MEM_SNES_WRAM, 0x00, 0x00, 0x00, 0x07,
+        IOVM1_OPCODE_WRITE, MEM_SNES_WRAM, 0x00, 0x10, 0x00, 0x01, 0xEE,
+    };
+    uint8_t other[sizeof(proc)];
+    struct iovm1_chip_t chips[] = {
+        [MEM_SNES_WRAM] = { 0x33, IOVM1_CHIP_READABLE | IOVM1_CHIP_WRITABLE },
+    };
+    uint64_t wram_r[IOVM1_ACL_WORDS(0x20000)] = {0};
+    uint64_t wram_w[IOVM1_ACL_WORDS(0x20000)] = {0};
+    struct iovm1_acl_chip_t acl[] = {
+        [MEM_SNES_WRAM] = { wram_r, wram_w, IOVM1_ACL_PAGES(0x20000) },
+    };
+    uint8_t d[IOVM1_CHECKPOINT_SIZE];
+    uint8_t bad[IOVM1_CHECKPOINT_SIZE];
+    struct iovm1_t b;
+    int r;
+
+    // suspend in the middle of WAIT_UNTIL:
+    fake_init_test(vm);
+    fake_host.wait_rounds = 3;
+    iovm1_load(vm, proc, sizeof(proc));
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_WAIT, iovm1_get_exec_state(vm), "state");
+    iovm1_checkpoint(vm, d);
+
+    // resume on another VM at the same instruction and run on to the READ:
+    iovm1_init(&b);
+    iovm1_load(&b, proc, sizeof(proc));
+    r = iovm1_restore(&b, d);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_restore() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_WAIT, iovm1_get_exec_state(&b), "restored state");
+    VERIFY_EQ_INT(0, b.p, "restored p");
+    VERIFY_EQ_INT(7, b.next_off, "restored next_off");
+    VERIFY_EQ_INT(IOVM1_OPSTATE_CONTINUE, b.wa.os, "restored opstate");
+    VERIFY_EQ_INT(0x10, b.wa.a, "restored wait address");
+    VERIFY_EQ_INT(0xFF, b.wa.k, "restored wait mask");
+    while (iovm1_get_exec_state(&b) != IOVM1_STATE_READ) {
+        r = iovm1_exec(&b);
+        VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    }
+    VERIFY_EQ_INT(0xBB, fake_host.mem[MEM_SNES_WRAM][0x21], "memory");
+
+    // a partially transferred READ resumes with what is left of it:
+    b.rd.a += 3;
+    b.rd.l -= 3;
+    iovm1_checkpoint(&b, d);
+    fake_init_test(vm);
+    iovm1_load(vm, proc, sizeof(proc));
+    r = iovm1_restore(vm, d);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_restore() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_READ, iovm1_get_exec_state(vm), "restored state");
+    VERIFY_EQ_INT(15, vm->p, "restored p");
+    VERIFY_EQ_INT(0x33, vm->rd.a, "restored read address");
+    VERIFY_EQ_INT(1, vm->rd.l, "restored read length");
+
+    // restoring requires a freshly loaded VM:
+    r = iovm1_restore(vm, d);
+    VERIFY_EQ_INT(IOVM1_ERROR_INVALID_OPERATION_FOR_STATE, r, "iovm1_restore() return value");
+
+    // the program must be the same:
+    memcpy(other, proc, sizeof(proc));
+    other[13] = 0xCC;
+    fake_init_test(vm);
+    iovm1_load(vm, other, sizeof(other));
+    r = iovm1_restore(vm, d);
+    VERIFY_EQ_INT(IOVM1_ERROR_PROGRAM_MISMATCH, r, "iovm1_restore() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_LOADED, iovm1_get_exec_state(vm), "state");
+
+    // malformed checkpoints are rejected:
+    fake_init_test(vm);
+    iovm1_load(vm, proc, sizeof(proc));
+    memcpy(bad, d, sizeof(d));
+    bad[20] = 0;
+    r = iovm1_restore(vm, bad);
+    VERIFY_EQ_INT(IOVM1_ERROR_OUT_OF_RANGE, r, "READ state at WAIT_UNTIL");
+    memcpy(bad, d, sizeof(d));
+    bad[24] = sizeof(proc) + 1;
+    r = iovm1_restore(vm, bad);
+    VERIFY_EQ_INT(IOVM1_ERROR_OUT_OF_RANGE, r, "next_off past the end");
+    memcpy(bad, d, sizeof(d));
+    bad[37] = 0x01;
+    r = iovm1_restore(vm, bad);
+    VERIFY_EQ_INT(IOVM1_ERROR_OUT_OF_RANGE, r, "read length");
+
+    // the remaining access is checked against this VM's chip table:
+    iovm1_set_chips(vm, chips, 1);
+    r = iovm1_restore(vm, d);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "iovm1_restore() return value");
+    chips[MEM_SNES_WRAM].size = 0x34;
+    r = iovm1_restore(vm, d);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_restore() return value");
+
+    // a verified program cannot be resumed in the middle of an instruction to run a write hidden in its data:
+    iovm1_acl_grant(wram_r, IOVM1_ACL_PAGES(0x20000), 0x0000, 0x100);
+    iovm1_acl_grant(wram_w, IOVM1_ACL_PAGES(0x20000), 0x0000, 0x100);
+    fake_init_test(vm);
+    iovm1_set_acl(vm, acl, 1);
+    iovm1_load(vm, hidden, sizeof(hidden));
+    r = iovm1_verify(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_verify() return value");
+    iovm1_checkpoint(vm, d);
+    memcpy(bad, d, sizeof(d));
+    bad[16] = IOVM1_STATE_EXECUTE_NEXT;
+    bad[24] = 6;
+    r = iovm1_restore(vm, bad);
+    VERIFY_EQ_INT(IOVM1_ERROR_OUT_OF_RANGE, r, "next_off inside an instruction");
+    bad[16] = IOVM1_STATE_WRITE;
+    bad[20] = 6;
+    bad[24] = sizeof(hidden);
+    r = iovm1_restore(vm, bad);
+    VERIFY_EQ_INT(IOVM1_ERROR_OUT_OF_RANGE, r, "p inside an instruction");
+    bad[20] = 0;
+    bad[24] = 6;
+    r = iovm1_restore(vm, bad);
+    VERIFY_EQ_INT(IOVM1_ERROR_OUT_OF_RANGE, r, "next_off inconsistent with p");
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(0x00, fake_host.mem[MEM_SNES_WRAM][0x1000], "memory");
+
+    return 0;
+}
+
+int test_summary(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_WAIT_UNTIL(IOVM1_CMP_EQ),
+        MEM_SNES_WRAM,
+        0x10,
+        0x00,
+        0x7E,
+        0x00,
+        0xFF,
+        IOVM1_MK_ABORT_UNLESS(IOVM1_CMP_EQ),
+        MEM_SNES_WRAM,
+        0x10,
+        0x00,
+        0x7E,
+        0x01,
+        0xFF,
+    };
+
+    fake_init_test(vm);
+    fake_host.clock = 1000;
+    fake_host.wait_ticks = 50;
+    fake_host.frame = 7;
+
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    // wait completes and abort fails in the same execution:
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_ABORTED, r, "iovm1_exec() return value");
+
+    VERIFY_EQ_INT(1, fake_host.end_count, "host_send_end() invocations");
+    VERIFY_EQ_INT(IOVM1_ERROR_ABORTED, fake_host.end_summary[0], "summary error");
+    VERIFY_EQ_INT(7, unpack_le(fake_host.end_summary + 1, 3), "summary failing offset");
+    VERIFY_EQ_INT(1000, unpack_le(fake_host.end_summary + 4, 4), "summary start time");
+    VERIFY_EQ_INT(0, unpack_le(fake_host.end_summary + 8, 4), "summary start time");
+    // clock reads: start, wait start, wait end (+50 in wait), end:
+    VERIFY_EQ_INT(53, unpack_le(fake_host.end_summary + 12, 4), "summary elapsed time");
+    VERIFY_EQ_INT(51, unpack_le(fake_host.end_summary + 16, 4), "summary wait time");
+    VERIFY_EQ_INT(7, unpack_le(fake_host.end_summary + 20, 4), "summary start frame");
+    VERIFY_EQ_INT(8, unpack_le(fake_host.end_summary + 24, 4), "summary end frame");
+    VERIFY_EQ_INT(2, unpack_le(fake_host.end_summary + 28, 4), "summary instructions");
+
+    return 0;
+}
+
+int test_hooks(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_RMW(IOVM1_ALU_OR),
+        MEM_SNES_WRAM,
+        0x10,
+        0x00,
+        0x7E,
+        0x01,
+        0xFF,
+        IOVM1_MK_CAS(IOVM1_CMP_EQ),
+        MEM_SNES_SRAM,
+        0x00,
+        0x00,
+        0x70,
+        0x01,
+        0xFF,
+        0x02,
+    };
+    const struct {
+        enum iovm1_hook h;
+        uint32_t arg;
+    } expected[] = {
+        { IOVM1_HOOK_STATE, IOVM1_STATE_INIT },
+        { IOVM1_HOOK_STATE, IOVM1_STATE_LOADED },
+        { IOVM1_HOOK_STATE, IOVM1_STATE_RESET },
+        { IOVM1_HOOK_INST_START, IOVM1_OPCODE_RMW },
+        { IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_TRY_READ_BYTE },
+        { IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_TRY_READ_BYTE },
+        { IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_TRY_WRITE_BYTE },
+        { IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_TRY_WRITE_BYTE },
+        { IOVM1_HOOK_INST_END, IOVM1_OPCODE_RMW },
+        { IOVM1_HOOK_INST_START, IOVM1_OPCODE_CAS },
+        { IOVM1_HOOK_HOST_ENTER, IOVM1_HOOK_HOST_TRY_READ_BYTE },
+        { IOVM1_HOOK_HOST_EXIT, IOVM1_HOOK_HOST_TRY_READ_BYTE },
+        { IOVM1_HOOK_STATE, IOVM1_STATE_EXECUTE_NEXT },
+        { IOVM1_HOOK_INST_END, IOVM1_OPCODE_CAS },
+        { IOVM1_HOOK_ERROR, IOVM1_ERROR_ABORTED },
+    };
+
+    fake_init_test(vm);
+    iovm1_prof_init(&fake_host.prof);
+
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_ABORTED, r, "iovm1_exec() return value");
+
+    VERIFY_EQ_INT((int)(sizeof(expected) / sizeof(expected[0])), fake_host.hook_count, "hook events");
+    for (int i = 0; i < fake_host.hook_count; i++) {
+        VERIFY_EQ_INT(expected[i].h, fake_host.hooks[i].h, "hook event");
+        VERIFY_EQ_INT(expected[i].arg, fake_host.hooks[i].arg, "hook event arg");
+    }
+
+    VERIFY_EQ_INT(1, (uint32_t)fake_host.prof.inst_count[IOVM1_OPCODE_RMW], "profiled RMW count");
+    VERIFY_EQ_INT(1, (uint32_t)fake_host.prof.inst_count[IOVM1_OPCODE_CAS], "profiled CAS count");
+    VERIFY_EQ_INT(2, (uint32_t)fake_host.prof.host_count[IOVM1_HOOK_HOST_TRY_READ_BYTE], "profiled try_read_byte calls");
+    VERIFY_EQ_INT(1, (uint32_t)fake_host.prof.chip_written[MEM_SNES_WRAM], "profiled WRAM bytes written");
+    VERIFY_EQ_INT(0, (uint32_t)fake_host.prof.chip_written[MEM_SNES_SRAM], "profiled SRAM bytes written");
+    VERIFY_EQ_INT(1, (uint32_t)fake_host.prof.errors[IOVM1_ERROR_ABORTED], "profiled aborts");
+
+    return 0;
+}
+
+int test_trace(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_RMW(IOVM1_ALU_XOR),
+        MEM_SNES_WRAM,
+        0x34,
+        0x12,
+        0x7E,
+        0xFF,
+        0xFF,
+    };
+    struct iovm1_trace_rec_t ring[4];
+    struct iovm1_trace_rec_t out[8];
+    struct iovm1_trace_t trace;
+    struct iovm1_trace_writer_t writer;
+    FILE *f;
+
+    r = iovm1_trace_init(&trace, ring, 3);
+    VERIFY_EQ_INT(-1, r, "iovm1_trace_init() return value");
+    r = iovm1_trace_init(&trace, ring, 4);
+    VERIFY_EQ_INT(0, r, "iovm1_trace_init() return value");
+
+    fake_init_test(vm);
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    // 8 events into a 4 record ring; the newest 4 are dropped:
+    fake_host.trace = &trace;
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    VERIFY_EQ_INT(4, (uint32_t)trace.dropped, "dropped records");
+
+    r = iovm1_trace_drain(&trace, out, 8);
+    VERIFY_EQ_INT(4, r, "iovm1_trace_drain() return value");
+    VERIFY_EQ_INT(IOVM1_HOOK_STATE, out[0].h, "record hook");
+    VERIFY_EQ_INT(IOVM1_STATE_LOADED, out[0].arg, "record arg");
+    VERIFY_EQ_INT(IOVM1_HOOK_INST_START, out[2].h, "record hook");
+    VERIFY_EQ_INT(IOVM1_OPCODE_RMW, out[2].arg, "record arg");
+    VERIFY_EQ_INT(MEM_SNES_WRAM, out[2].c, "record chip");
+    VERIFY_EQ_INT(0x7E1234, out[2].a, "record address");
+    VERIFY_EQ_INT(7, out[2].vm, "record vm id");
+    VERIFY_EQ_INT(IOVM1_HOOK_HOST_ENTER, out[3].h, "record hook");
+
+    // drained slots are reused:
+    r = iovm1_exec(vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec() return value");
+    r = iovm1_trace_drain(&trace, out, 8);
+    VERIFY_EQ_INT(1, r, "iovm1_trace_drain() return value");
+    VERIFY_EQ_INT(IOVM1_STATE_ENDED, out[0].s, "record state");
+
+    // consumer thread writes every record to the trace file:
+    f = tmpfile();
+    r = iovm1_trace_writer_start(&writer, &trace, f);
+    VERIFY_EQ_INT(0, r, "iovm1_trace_writer_start() return value");
+    for (int i = 0; i < 100; i++) {
+        r = iovm1_exec_reset(vm);
+        VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_exec_reset() return value");
+        while (iovm1_get_exec_state(vm) < IOVM1_STATE_ENDED) {
+            iovm1_exec(vm);
+        }
+        // let the consumer keep up with the tiny ring:
+        while (__atomic_load_n(&trace.tail, __ATOMIC_ACQUIRE) != trace.head) {
+            sched_yield();
+        }
+    }
+    iovm1_trace_writer_stop(&writer);
+
+    rewind(f);
+    r = iovm1_trace_read_header(f);
+    VERIFY_EQ_INT(0, r, "iovm1_trace_read_header() return value");
+    for (r = 0; fread(out, sizeof(out[0]), 1, f) == 1; r++) {
+    }
+    fclose(f);
+    // 9 events per run; every event was either written or counted as dropped:
+    VERIFY_EQ_INT(100 * 9, r + (int)trace.dropped - 4, "records written");
+
+    return 0;
+}
+
+int test_chrome(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_RMW(IOVM1_ALU_OR),
+        MEM_SNES_WRAM,
+        0x00,
+        0x02,
+        0x7E,
+        0x80,
+        0xFF,
+    };
+    struct iovm1_trace_rec_t ring[16];
+    struct iovm1_trace_rec_t out[16];
+    struct iovm1_trace_t trace;
+    static struct iovm1_chrome_t chrome;
+    char json[4096];
+    size_t n;
+    FILE *f;
+    int b = 0, e = 0;
+
+    iovm1_trace_init(&trace, ring, 16);
+
+    fake_init_test(vm);
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+
+    fake_host.trace = &trace;
+    while (iovm1_get_exec_state(vm) < IOVM1_STATE_ENDED) {
+        iovm1_exec(vm);
+    }
+    VERIFY_EQ_INT(0, (uint32_t)trace.dropped, "dropped records");
+
+    f = tmpfile();
+    r = iovm1_chrome_begin(&chrome, f);
+    VERIFY_EQ_INT(0, r, "iovm1_chrome_begin() return value");
+    n = iovm1_trace_drain(&trace, out, 16);
+    for (size_t i = 0; i < n; i++) {
+        iovm1_chrome_record(&chrome, &out[i]);
+    }
+    r = iovm1_chrome_end(&chrome);
+    VERIFY_EQ_INT(0, r, "iovm1_chrome_end() return value");
+
+    rewind(f);
+    n = fread(json, 1, sizeof(json) - 1, f);
+    json[n] = 0;
+    fclose(f);
+
+    VERIFY_EQ_INT(1, strstr(json, "\"name\":\"vm 7\"") != 0, "track name");
+    VERIFY_EQ_INT(1, strstr(json, "\"name\":\"RMW\"") != 0, "instruction span");
+    VERIFY_EQ_INT(1, strstr(json, "\"addr\":\"7e0200\"") != 0, "instruction address");
+    VERIFY_EQ_INT(1, strstr(json, "\"name\":\"try_read_byte\"") != 0, "host call span");
+    VERIFY_EQ_INT(1, strstr(json, "\"name\":\"ENDED\"") != 0, "state event");
+    VERIFY_EQ_INT(0, strcmp(json + n - 4, "\n]}\n"), "document end");
+
+    // every span is closed:
+    for (const char *q = json; (q = strstr(q, "\"ph\":\"")) != 0; q += 6) {
+        b += q[6] == 'B';
+        e += q[6] == 'E';
+    }
+    VERIFY_EQ_INT(3, b, "begin events");
+    VERIFY_EQ_INT(b, e, "end events");
+
+    return 0;
+}
+
+int test_hist(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_WAIT_UNTIL(IOVM1_CMP_EQ),
+        MEM_SNES_WRAM,
+        0x10,
+        0x00,
+        0x7E,
+        0x00,
+        0xFF,
+        IOVM1_MK_RMW(IOVM1_ALU_ADD),
+        MEM_SNES_WRAM,
+        0x10,
+        0x00,
+        0x7E,
+        0x01,
+        0x00,
+    };
+    static struct iovm1_hist_t h;
+    static struct iovm1_hists_t hists;
+
+    // exact below 16, then within 1/16 of the recorded value:
+    iovm1_hist_init(&h);
+    VERIFY_EQ_INT(0, (uint32_t)iovm1_hist_percentile(&h, 50), "empty percentile");
+    for (int i = 1; i <= 100; i++) {
+        iovm1_hist_record(&h, i);
+    }
+    iovm1_hist_record(&h, 1000000);
+    VERIFY_EQ_INT(101, (uint32_t)h.count, "count");
+    VERIFY_EQ_INT(1, (uint32_t)h.min, "min");
+    VERIFY_EQ_INT(1000000, (uint32_t)h.max, "max");
+    VERIFY_EQ_INT(1, (uint32_t)iovm1_hist_percentile(&h, 0), "p0");
+    VERIFY_EQ_INT(11, (uint32_t)iovm1_hist_percentile(&h, 10), "p10");
+    VERIFY_EQ_INT(51, (uint32_t)iovm1_hist_percentile(&h, 50), "p50");
+    VERIFY_EQ_INT(103, (uint32_t)iovm1_hist_percentile(&h, 99), "p99");
+    VERIFY_EQ_INT(1000000, (uint32_t)iovm1_hist_percentile(&h, 100), "p100");
+
+    iovm1_hists_init(&hists);
+    fake_init_test(vm);
+    fake_host.hists = &hists;
+    fake_host.wait_rounds = 3;
+
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+    while (iovm1_get_exec_state(vm) < IOVM1_STATE_ENDED) {
+        iovm1_exec(vm);
+    }
+    VERIFY_EQ_INT(IOVM1_STATE_ENDED, iovm1_get_exec_state(vm), "state");
+
+    VERIFY_EQ_INT(1, (uint32_t)hists.program.count, "program count");
+    VERIFY_EQ_INT(1, (uint32_t)hists.wait.count, "wait count");
+    // 4 wait state machine calls; 1 read and 1 write for RMW:
+    VERIFY_EQ_INT(4, (uint32_t)hists.host[IOVM1_OPCODE_WAIT_UNTIL].count, "wait host calls");
+    VERIFY_EQ_INT(2, (uint32_t)hists.host[IOVM1_OPCODE_RMW].count, "rmw host calls");
+    // only the wait called a state machine; 3 of its calls continued:
+    VERIFY_EQ_INT(1, (uint32_t)hists.reentries.count, "reentries count");
+    VERIFY_EQ_INT(3, (uint32_t)iovm1_hist_percentile(&hists.reentries, 100), "reentries");
+    VERIFY_EQ_INT(1, hists.wait.max <= hists.program.max, "wait within program");
+
+    return 0;
+}
+
+int test_metrics(struct iovm1_t *vm) {
+    int r;
+    uint8_t proc[] = {
+        IOVM1_MK_RMW(IOVM1_ALU_ADD),
+        MEM_SNES_WRAM,
+        0x20,
+        0x00,
+        0x7E,
+        0x01,
+        0x00,
+        IOVM1_MK_ABORT_UNLESS(IOVM1_CMP_EQ),
+        MEM_SNES_WRAM,
+        0x20,
+        0x00,
+        0x7E,
+        0x05,
+        0xFF,
+    };
+    static struct iovm1_metrics_t metrics;
+    static struct iovm1_hists_t hists;
+    struct iovm1_metric_t *hits, *rate;
+    char text[8192];
+    char path[] = "/tmp/iovm_metrics_XXXXXX";
+    char tmp[sizeof(path) + 4];
+    size_t n;
+    FILE *f;
+
+    iovm1_metrics_init(&metrics);
+    iovm1_hists_init(&hists);
+    iovm1_metrics_attach_hists(&metrics, &hists);
+    hits = iovm1_metrics_add(&metrics, IOVM1_METRIC_COUNTER, "cache_hits_total", "cache=\"rom\"", "Cache hits.");
+    iovm1_metrics_add(&metrics, IOVM1_METRIC_COUNTER, "cache_hits_total", "cache=\"sram\"", "Cache hits.");
+    rate = iovm1_metrics_add(&metrics, IOVM1_METRIC_GAUGE, "cache_hit_ratio", 0, "Cache hit ratio.");
+    iovm1_metric_inc(hits, 3);
+    iovm1_metric_set(rate, 0.75);
+
+    fake_init_test(vm);
+    fake_host.metrics = &metrics;
+    fake_host.hists = &hists;
+
+    // abort fails:
+    r = iovm1_load(vm, proc, sizeof(proc));
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "iovm1_load() return value");
+    while (iovm1_get_exec_state(vm) < IOVM1_STATE_ENDED) {
+        iovm1_exec(vm);
+    }
+    VERIFY_EQ_INT(IOVM1_ERROR_ABORTED, vm->e, "vm->e");
+
+    f = tmpfile();
+    r = iovm1_metrics_write(&metrics, f);
+    VERIFY_EQ_INT(0, r, "iovm1_metrics_write() return value");
+    rewind(f);
+    n = fread(text, 1, sizeof(text) - 1, f);
+    text[n] = 0;
+    fclose(f);
+
+    VERIFY_EQ_INT(1, strstr(text, "iovm_programs_loaded_total 1\n") != 0, "programs loaded");
+    VERIFY_EQ_INT(1, strstr(text, "iovm_programs_executed_total 1\n") != 0, "programs executed");
+    VERIFY_EQ_INT(1, strstr(text, "iovm_errors_total{code=\"5\"} 1\n") != 0, "errors");
+    VERIFY_EQ_INT(1, strstr(text, "iovm_instructions_total{opcode=\"RMW\"} 1\n") != 0, "instructions");
+    VERIFY_EQ_INT(1, strstr(text, "iovm_chip_read_bytes_total{chip=\"0\"} 2\n") != 0, "bytes read");
+    VERIFY_EQ_INT(1, strstr(text, "iovm_chip_written_bytes_total{chip=\"0\"} 1\n") != 0, "bytes written");
+    VERIFY_EQ_INT(1, strstr(text, "iovm_program_seconds_bucket{le=\"+Inf\"} 1\n") != 0, "program histogram");
+    VERIFY_EQ_INT(1, strstr(text, "iovm_cache_hits_total{cache=\"rom\"} 3\n") != 0, "host counter");
+    VERIFY_EQ_INT(1, strstr(text, "iovm_cache_hits_total{cache=\"sram\"} 0\n") != 0, "host counter");
+    VERIFY_EQ_INT(1, strstr(text, "iovm_cache_hit_ratio 0.75\n") != 0, "host gauge");
+    // one TYPE line per metric name:
+    VERIFY_EQ_INT(1, strstr(strstr(text, "# TYPE iovm_cache_hits_total") + 1, "# TYPE iovm_cache_hits_total") == 0, "TYPE lines");
+
+    // background writer replaces the file atomically and leaves no temporary behind:
+    close(mkstemp(path));
+    r = iovm1_metrics_writer_start(&metrics, path, 1000);
+    VERIFY_EQ_INT(0, r, "iovm1_metrics_writer_start() return value");
+    iovm1_metric_inc(hits, 1);
+    iovm1_metrics_writer_stop(&metrics);
+
+    f = fopen(path, "r");
+    VERIFY_EQ_INT(1, f != 0, "metrics file exists");
+    n = fread(text, 1, sizeof(text) - 1, f);
+    text[n] = 0;
+    fclose(f);
+    VERIFY_EQ_INT(1, strstr(text, "iovm_cache_hits_total{cache=\"rom\"} 4\n") != 0, "final write");
+    remove(path);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    f = fopen(tmp, "r");
+    if (f) {
+        fclose(f);
+    }
+    VERIFY_EQ_INT(1, f == 0, "temporary file removed");
+
+    return 0;
+}
+
+static int refhost_replies;
+static uint32_t refhost_reply_bytes;
+static uint8_t refhost_reply_last[256];
+
+static void refhost_reply(void *ctx, struct iovm1_t *vm, enum iovm1_host_reply r, const uint8_t *d, uint32_t l) {
+    refhost_replies++;
+    refhost_reply_bytes += l;
+    memcpy(refhost_reply_last, d, l);
+}
+
+int test_refhost(struct iovm1_t *vm) {
+    static struct iovm1_host_t h;
+    uint8_t proc[] = { 0x11, 0x22, 0x33, 0x44 };
+    uint8_t b;
+    int r;
+
+    r = iovm1_host_init(&h, 0x100000, 0x2000);
+    VERIFY_EQ_INT(0, r, "iovm1_host_init() return value");
+    h.reply = refhost_reply;
+    refhost_replies = 0;
+    refhost_reply_bytes = 0;
+
+    VERIFY_EQ_INT(0x20000, h.chip[MEM_SNES_WRAM].size, "WRAM size");
+    VERIFY_EQ_INT(0x200, h.chip[MEM_SNES_CGRAM].size, "CGRAM size");
+    VERIFY_EQ_INT(0x220, h.chip[MEM_SNES_OAM].size, "OAM size");
+    VERIFY_EQ_INT(0x100000, h.chip[MEM_SNES_ROM].size, "ROM size");
+
+    // access rights and ranges:
+    r = iovm1_host_try_write_byte(&h, MEM_SNES_WRAM, 0x1FFFF, 0x5A);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "last WRAM byte write");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_WRAM, 0x1FFFF, &b);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "last WRAM byte read");
+    VERIFY_EQ_INT(0x5A, b, "last WRAM byte");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_WRAM, 0x20000, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "WRAM read past end");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_CGRAM, 0x200, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "CGRAM read past end");
+    r = iovm1_host_try_write_byte(&h, MEM_SNES_ROM, 0, 0);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_NOT_WRITABLE, r, "ROM write");
+    r = iovm1_host_try_read_byte(&h, (enum iovm1_memory_chip)9, 0, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_UNDEFINED, r, "undefined chip");
+    h.chip[MEM_SNES_ARAM].readable = 0;
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ARAM, 0, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_NOT_READABLE, r, "unreadable chip");
+    r = iovm1_host_check(&h, MEM_SNES_SRAM, 0x1F00, 0x100, 1);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "SRAM range to end");
+    r = iovm1_host_check(&h, MEM_SNES_SRAM, 0x1F00, 0x101, 1);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "SRAM range past end");
+
+    // chunked write then read continue until the transfer completes:
+    iovm1_init(vm);
+    vm->m.ptr = proc;
+    vm->m.len = sizeof(proc);
+    h.chunk = 3;
+    vm->wr.os = IOVM1_OPSTATE_INIT;
+    vm->wr.c = MEM_SNES_SRAM;
+    vm->wr.a = 0x100;
+    vm->wr.l = 4;
+    vm->wr.p = 0;
+    r = iovm1_host_write_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "write state machine return value");
+    VERIFY_EQ_INT(IOVM1_OPSTATE_CONTINUE, vm->wr.os, "write opstate");
+    r = iovm1_host_write_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_OPSTATE_COMPLETED, vm->wr.os, "write opstate");
+    VERIFY_EQ_INT(0x44, h.chip[MEM_SNES_SRAM].mem[0x103], "written byte");
+
+    vm->rd.os = IOVM1_OPSTATE_INIT;
+    vm->rd.c = MEM_SNES_SRAM;
+    vm->rd.a = 0x100;
+    vm->rd.l = 4;
+    r = iovm1_host_read_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_OPSTATE_CONTINUE, vm->rd.os, "read opstate");
+    r = iovm1_host_read_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_OPSTATE_COMPLETED, vm->rd.os, "read opstate");
+    VERIFY_EQ_INT(2, refhost_replies, "read replies");
+    VERIFY_EQ_INT(4, refhost_reply_bytes, "read reply bytes");
+    VERIFY_EQ_INT(0x44, refhost_reply_last[0], "last read reply byte");
+
+    // out of range reads fail before any reply:
+    vm->rd.os = IOVM1_OPSTATE_INIT;
+    vm->rd.a = 0x1FFE;
+    vm->rd.l = 4;
+    r = iovm1_host_read_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "read state machine return value");
+    VERIFY_EQ_INT(2, refhost_replies, "read replies");
+
+    // verify replies with the first mismatch offset:
+    vm->vf.os = IOVM1_OPSTATE_INIT;
+    vm->vf.c = MEM_SNES_SRAM;
+    vm->vf.a = 0x100;
+    vm->vf.l = 4;
+    vm->vf.p = 0;
+    vm->vf.r = IOVM1_COMPARE_REPLY_FIRST_MISMATCH;
+    h.chip[MEM_SNES_SRAM].mem[0x102] = 0;
+    r = iovm1_host_verify_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "verify state machine return value");
+    VERIFY_EQ_INT(2, refhost_reply_last[0], "first mismatch");
+
+    // chip table for the core:
+    {
+        struct iovm1_chip_t t[IOVM1_HOST_CHIPS];
+        iovm1_host_chip_table(&h, t);
+        VERIFY_EQ_INT(0x20000, t[MEM_SNES_WRAM].size, "WRAM table size");
+        VERIFY_EQ_INT(IOVM1_CHIP_READABLE, t[MEM_SNES_ROM].flags, "ROM table flags");
+        VERIFY_EQ_INT(IOVM1_CHIP_WRITABLE, t[MEM_SNES_ARAM].flags, "unreadable ARAM table flags");
+    }
+
+    iovm1_host_free(&h);
+    return 0;
+}
+
+static uint32_t refgame_vblanks;
+static uint32_t refgame_last_frame;
+
+static void refgame_vblank(void *ctx, uint32_t frame, uint64_t t_ns) {
+    refgame_vblanks++;
+    refgame_last_frame = frame;
+}
+
+int test_refhost_game(struct iovm1_t *vm) {
+    static struct iovm1_host_t h;
+    static struct iovm1_host_game_t g;
+    uint32_t frame;
+    int polls = 0;
+    int r;
+
+    r = iovm1_host_init(&h, 0, 0);
+    VERIFY_EQ_INT(0, r, "iovm1_host_init() return value");
+    refgame_vblanks = 0;
+
+    iovm1_host_game_init(&g, &h, 1000, 0x1A);
+    g.vblank = refgame_vblank;
+    r = iovm1_host_game_add_region(&g, MEM_SNES_WRAM, 0x400, 0x10, 2);
+    VERIFY_EQ_INT(0, r, "add region return value");
+    r = iovm1_host_game_add_region(&g, MEM_SNES_CGRAM, 0x1F0, 0x20, 1);
+    VERIFY_EQ_INT(-1, r, "add out of range region return value");
+
+    // wait for the frame counter to reach 3 with the host's wait state machine:
+    iovm1_init(vm);
+    vm->wa.os = IOVM1_OPSTATE_INIT;
+    vm->wa.c = MEM_SNES_WRAM;
+    vm->wa.a = 0x1A;
+    vm->wa.v = 3;
+    vm->wa.k = 0xFF;
+    vm->wa.q = IOVM1_CMP_NLT;
+
+    r = iovm1_host_game_start(&g);
+    VERIFY_EQ_INT(0, r, "iovm1_host_game_start() return value");
+    do {
+        r = iovm1_host_wait_state_machine(&h, vm);
+        if (r != IOVM1_SUCCESS) {
+            break;
+        }
+        usleep(100);
+    } while (vm->wa.os != IOVM1_OPSTATE_COMPLETED && ++polls < 20000);
+    iovm1_host_game_stop(&g);
+
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "wait state machine return value");
+    VERIFY_EQ_INT(IOVM1_OPSTATE_COMPLETED, vm->wa.os, "wait opstate");
+
+    // every frame advanced the counter, the region and the vblank hook together:
+    frame = h.frame;
+    VERIFY_EQ_INT(1, frame >= 3, "frames elapsed");
+    VERIFY_EQ_INT((uint8_t)frame, h.chip[MEM_SNES_WRAM].mem[0x1A], "frame counter byte");
+    VERIFY_EQ_INT((uint8_t)(frame * 2), h.chip[MEM_SNES_WRAM].mem[0x40F], "scripted region byte");
+    VERIFY_EQ_INT(0, h.chip[MEM_SNES_WRAM].mem[0x410], "byte after scripted region");
+    VERIFY_EQ_INT(frame, refgame_vblanks, "vblank hook calls");
+    VERIFY_EQ_INT(frame, refgame_last_frame, "last vblank frame");
+    VERIFY_EQ_INT(1, g.vblank_ns != 0, "vblank timestamp");
+
+    iovm1_host_free(&h);
+    return 0;
+}
+
+static int refseq_torn;
+
+// the game thread steps every byte of the region together, so a consistent reply has all bytes equal:
+static void refseq_reply(void *ctx, struct iovm1_t *vm, enum iovm1_host_reply r, const uint8_t *d, uint32_t l) {
+    for (uint32_t i = 1; i < l; i++) {
+        if (d[i] != d[0]) {
+            refseq_torn++;
+            return;
+        }
+    }
+}
+
+int test_refhost_seqlock(struct iovm1_t *vm) {
+    static struct iovm1_host_t h;
+    static struct iovm1_host_game_t g;
+    uint32_t seq;
+    int r;
+
+    r = iovm1_host_init(&h, 0, 0);
+    VERIFY_EQ_INT(0, r, "iovm1_host_init() return value");
+    h.reply = refseq_reply;
+    h.seqlock = 1;
+    refseq_torn = 0;
+
+    seq = h.seq;
+    iovm1_host_publish_begin(&h);
+    VERIFY_EQ_INT(1, h.seq & 1, "sequence odd while publishing");
+    iovm1_host_publish_end(&h);
+    VERIFY_EQ_INT(seq + 2, h.seq, "sequence after publishing");
+
+    // read a region the game thread rewrites as fast as it can:
+    iovm1_host_game_init(&g, &h, 100000, 0x1A);
+    r = iovm1_host_game_add_region(&g, MEM_SNES_WRAM, 0x2000, 0x8000, 1);
+    VERIFY_EQ_INT(0, r, "add region return value");
+    r = iovm1_host_game_start(&g);
+    VERIFY_EQ_INT(0, r, "iovm1_host_game_start() return value");
+
+    iovm1_init(vm);
+    for (int i = 0; i < 5000; i++) {
+        vm->rd.os = IOVM1_OPSTATE_INIT;
+        vm->rd.c = MEM_SNES_WRAM;
+        vm->rd.a = 0x2000 + (uint24_t)((i * 256) & 0x7FFF);
+        vm->rd.l = 256;
+        r = iovm1_host_read_state_machine(&h, vm);
+        if (r != IOVM1_SUCCESS) {
+            break;
+        }
+    }
+    iovm1_host_game_stop(&g);
+
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "read state machine return value");
+    VERIFY_EQ_INT(0, refseq_torn, "torn read replies");
+    VERIFY_EQ_INT(0, h.seq & 1, "sequence even after game thread stops");
+    VERIFY_EQ_INT(1, h.seq >= 2, "frames published");
+
+    iovm1_host_free(&h);
+    return 0;
+}
+
+int test_refhost_map(struct iovm1_t *vm) {
+    static struct iovm1_host_t h;
+    static uint8_t dump[0x21000];
+    char path[] = "/tmp/iovm_state_XXXXXX";
+    uint8_t b;
+    FILE *f;
+    int fd;
+    int r;
+
+    // a state dump with a 4 KiB header followed by 128 KiB of WRAM:
+    for (uint32_t i = 0; i < sizeof(dump); i++) {
+        dump[i] = (uint8_t)(i >> 4);
+    }
+    fd = mkstemp(path);
+    VERIFY_EQ_INT(1, fd >= 0, "mkstemp()");
+    VERIFY_EQ_INT(1, write(fd, dump, sizeof(dump)) == (ssize_t)sizeof(dump), "write dump");
+    close(fd);
+
+    r = iovm1_host_init(&h, 0x100000, 0);
+    VERIFY_EQ_INT(0, r, "iovm1_host_init() return value");
+
+    // read-only ROM over the whole file:
+    r = iovm1_host_map_file(&h, MEM_SNES_ROM, path, 0, 0, IOVM1_HOST_MAP_SEQUENTIAL);
+    VERIFY_EQ_INT(0, r, "map ROM return value");
+    VERIFY_EQ_INT(0x21000, h.chip[MEM_SNES_ROM].size, "ROM size");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0x20FFF, &b);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "ROM read");
+    VERIFY_EQ_INT(0xFF, b, "ROM byte");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0x21000, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "ROM read past end");
+
+    // read-only WRAM at an unaligned offset:
+    r = iovm1_host_map_file(&h, MEM_SNES_WRAM, path, 0x1010, 0x10000, IOVM1_HOST_MAP_RANDOM);
+    VERIFY_EQ_INT(0, r, "map WRAM return value");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_WRAM, 0, &b);
+    VERIFY_EQ_INT(0x01, b, "WRAM first byte");
+    r = iovm1_host_try_write_byte(&h, MEM_SNES_WRAM, 0, 0x55);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_NOT_WRITABLE, r, "read-only WRAM write");
+
+    // copy-on-write WRAM takes writes without touching the file:
+    r = iovm1_host_map_file(&h, MEM_SNES_WRAM, path, 0x1000, 0x20000, IOVM1_HOST_MAP_COPY_ON_WRITE);
+    VERIFY_EQ_INT(0, r, "map WRAM copy-on-write return value");
+    r = iovm1_host_try_write_byte(&h, MEM_SNES_WRAM, 0x1FFFF, 0x55);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "copy-on-write WRAM write");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_WRAM, 0x1FFFF, &b);
+    VERIFY_EQ_INT(0x55, b, "copy-on-write WRAM byte");
+
+    // ranges past the end of the file fail and keep the current mapping:
+    r = iovm1_host_map_file(&h, MEM_SNES_WRAM, path, 0x2000, 0x20000, 0);
+    VERIFY_EQ_INT(-1, r, "map past end of file return value");
+    VERIFY_EQ_INT(0x55, h.chip[MEM_SNES_WRAM].mem[0x1FFFF], "mapping kept");
+
+    iovm1_host_free(&h);
+
+    f = fopen(path, "rb");
+    VERIFY_EQ_INT(1, f != 0, "dump exists");
+    fseek(f, 0x20FFF, SEEK_SET);
+    VERIFY_EQ_INT(0xFF, fgetc(f), "dump byte unchanged");
+    fclose(f);
+    remove(path);
+
+    return 0;
+}
+
+int test_refhost_mapping(struct iovm1_t *vm) {
+    static struct iovm1_host_t h;
+    uint8_t proc[32];
+    uint8_t *rom;
+    uint8_t b;
+    int r;
+
+    r = iovm1_host_init(&h, 0x600000, 0x2000);
+    VERIFY_EQ_INT(0, r, "iovm1_host_init() return value");
+    h.reply = refhost_reply;
+    rom = h.chip[MEM_SNES_ROM].mem;
+    for (uint32_t i = 0; i < 0x600000; i++) {
+        rom[i] = (uint8_t)((i >> 16) * 7 + i);
+    }
+    h.chip[MEM_SNES_SRAM].mem[0] = 0xA5;
+
+    // LoROM:
+    iovm1_host_set_mapping(&h, IOVM1_HOST_MAPPING_LOROM);
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0x018000, &b);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "LoROM $01:8000 read");
+    VERIFY_EQ_INT(rom[0x8000], b, "LoROM $01:8000");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0xFFFFFF, &b);
+    VERIFY_EQ_INT(rom[0x3FFFFF % 0x600000], b, "LoROM $FF:FFFF");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0x007FFF, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "LoROM $00:7FFF read");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0x7E8000, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "LoROM $7E:8000 read");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_SRAM, 0xF00000, &b);
+    VERIFY_EQ_INT(0xA5, b, "LoROM SRAM $F0:0000");
+    // 8 KiB of SRAM fills only the start of its 32 KiB window:
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_SRAM, 0x702000, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "LoROM SRAM $70:2000 read");
+    r = iovm1_host_try_write_byte(&h, MEM_SNES_ROM, 0x008000, 0);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_NOT_WRITABLE, r, "LoROM ROM write");
+    // $00:FFFF continues at $01:0000 on the bus, which is not ROM:
+    r = iovm1_host_check(&h, MEM_SNES_ROM, 0x00FFF0, 0x20, 0);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "LoROM range across banks");
+
+    // HiROM:
+    iovm1_host_set_mapping(&h, IOVM1_HOST_MAPPING_HIROM);
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0xC12345, &b);
+    VERIFY_EQ_INT(rom[0x012345], b, "HiROM $C1:2345");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0x018123, &b);
+    VERIFY_EQ_INT(rom[0x018123], b, "HiROM $01:8123");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0x010123, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "HiROM $01:0123 read");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_SRAM, 0xA16000, &b);
+    VERIFY_EQ_INT(0xA5, b, "HiROM SRAM $A1:6000 mirror");
+
+    // a READ crossing $C0:FFFF splits into one reply per window:
+    refhost_replies = 0;
+    refhost_reply_bytes = 0;
+    iovm1_init(vm);
+    vm->rd.os = IOVM1_OPSTATE_INIT;
+    vm->rd.c = MEM_SNES_ROM;
+    vm->rd.a = 0xC0FFF0;
+    vm->rd.l = 32;
+    r = iovm1_host_read_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_OPSTATE_CONTINUE, vm->rd.os, "read opstate at window end");
+    r = iovm1_host_read_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_OPSTATE_COMPLETED, vm->rd.os, "read opstate");
+    VERIFY_EQ_INT(2, refhost_replies, "read replies");
+    VERIFY_EQ_INT(32, refhost_reply_bytes, "read reply bytes");
+    VERIFY_EQ_INT(rom[0x010000], refhost_reply_last[0], "second window first byte");
+
+    // COMPARE across the same boundary:
+    memcpy(proc, &rom[0xFFF0], 32);
+    proc[20] ^= 0xFF;
+    vm->m.ptr = proc;
+    vm->m.len = sizeof(proc);
+    vm->vf.os = IOVM1_OPSTATE_INIT;
+    vm->vf.c = MEM_SNES_ROM;
+    vm->vf.a = 0xC0FFF0;
+    vm->vf.l = 32;
+    vm->vf.p = 0;
+    vm->vf.r = IOVM1_COMPARE_REPLY_FIRST_MISMATCH;
+    r = iovm1_host_verify_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "verify state machine return value");
+    VERIFY_EQ_INT(20, refhost_reply_last[0], "first mismatch across windows");
+
+    // SEARCH replies with bus addresses:
+    proc[0] = rom[0x012345];
+    proc[1] = rom[0x012346];
+    vm->sr.os = IOVM1_OPSTATE_INIT;
+    vm->sr.c = MEM_SNES_ROM;
+    vm->sr.a = 0xC12300;
+    vm->sr.l = 0x100;
+    vm->sr.p = 0;
+    vm->sr.n = 2;
+    vm->sr.k = 0;
+    vm->sr.m = 1;
+    r = iovm1_host_search_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "search state machine return value");
+    VERIFY_EQ_INT(0x45, refhost_reply_last[0], "match address low");
+    VERIFY_EQ_INT(0xC1, refhost_reply_last[2], "match address bank");
+
+    // ExHiROM:
+    iovm1_host_set_mapping(&h, IOVM1_HOST_MAPPING_EXHIROM);
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0x401234, &b);
+    VERIFY_EQ_INT(rom[0x401234], b, "ExHiROM $40:1234");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0xC01234, &b);
+    VERIFY_EQ_INT(rom[0x001234], b, "ExHiROM $C0:1234");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_ROM, 0x018000, &b);
+    VERIFY_EQ_INT(rom[0x418000], b, "ExHiROM $01:8000");
+
+    iovm1_host_free(&h);
+    return 0;
+}
+
+static uint32_t refchip_refreshes;
+static uint32_t refchip_committed;
+
+// virtual status region: byte 0 counts refreshes, byte 1 mirrors the last byte written to byte 2:
+static void refchip_refresh(void *ctx, struct iovm1_host_t *h, enum iovm1_memory_chip c, uint32_t o, uint32_t l) {
+    refchip_refreshes++;
+    h->chip[c].mem[0] = (uint8_t)refchip_refreshes;
+}
+
+static void refchip_commit(void *ctx, struct iovm1_host_t *h, enum iovm1_memory_chip c, uint32_t o, uint32_t l) {
+    refchip_committed += l;
+    h->chip[c].mem[1] = h->chip[c].mem[2];
+}
+
+int test_refhost_registry(struct iovm1_t *vm) {
+    static struct iovm1_host_t h;
+    struct iovm1_host_chip_desc_t iram = { 0x800, 1, 1, 0, 0, 0 };
+    struct iovm1_host_chip_desc_t status = { 16, 1, 1, 0, refchip_refresh, refchip_commit };
+    struct iovm1_host_chip_desc_t empty = { 0, 1, 1, 0, 0, 0 };
+    uint8_t proc[] = { 0x5A };
+    uint8_t b;
+    int r;
+
+    r = iovm1_host_init(&h, 0x8000, 0);
+    VERIFY_EQ_INT(0, r, "iovm1_host_init() return value");
+    h.reply = refhost_reply;
+    refchip_refreshes = 0;
+    refchip_committed = 0;
+
+    // expansion chips are undefined until registered:
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_SA1_IRAM, 0, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_UNDEFINED, r, "unregistered I-RAM read");
+    r = iovm1_host_register_chip(&h, MEM_SNES_SA1_IRAM, &iram);
+    VERIFY_EQ_INT(0, r, "iovm1_host_register_chip() return value");
+    r = iovm1_host_try_write_byte(&h, MEM_SNES_SA1_IRAM, 0x7FF, 0x33);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "I-RAM write");
+    r = iovm1_host_try_read_byte(&h, MEM_SNES_SA1_IRAM, 0x800, &b);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_ADDRESS_OUT_OF_RANGE, r, "I-RAM read past end");
+    r = iovm1_host_register_chip(&h, MEM_SNES_SFX_RAM, &empty);
+    VERIFY_EQ_INT(-1, r, "empty chip registration");
+
+    // virtual regions refresh before every read and commit after every write:
+    r = iovm1_host_register_chip(&h, MEM_HOST_FIRST + 3, &status);
+    VERIFY_EQ_INT(0, r, "iovm1_host_register_chip() return value");
+    r = iovm1_host_try_read_byte(&h, MEM_HOST_FIRST + 3, 0, &b);
+    VERIFY_EQ_INT(1, b, "refreshed status byte");
+
+    iovm1_init(vm);
+    vm->m.ptr = proc;
+    vm->m.len = sizeof(proc);
+    vm->wr.os = IOVM1_OPSTATE_INIT;
+    vm->wr.c = MEM_HOST_FIRST + 3;
+    vm->wr.a = 2;
+    vm->wr.l = 1;
+    vm->wr.p = 0;
+    r = iovm1_host_write_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_OPSTATE_COMPLETED, vm->wr.os, "write opstate");
+    VERIFY_EQ_INT(1, refchip_committed, "committed bytes");
+
+    vm->rd.os = IOVM1_OPSTATE_INIT;
+    vm->rd.c = MEM_HOST_FIRST + 3;
+    vm->rd.a = 0;
+    vm->rd.l = 2;
+    r = iovm1_host_read_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_OPSTATE_COMPLETED, vm->rd.os, "read opstate");
+    VERIFY_EQ_INT(2, refhost_reply_last[0], "refreshed status byte");
+    VERIFY_EQ_INT(0x5A, refhost_reply_last[1], "committed status byte");
+
+    // every id shows up in the chip table for the core:
+    {
+        struct iovm1_chip_t t[IOVM1_HOST_CHIPS];
+        iovm1_host_chip_table(&h, t);
+        VERIFY_EQ_INT(0x800, t[MEM_SNES_SA1_IRAM].size, "I-RAM table size");
+        VERIFY_EQ_INT(16, t[MEM_HOST_FIRST + 3].size, "status table size");
+        VERIFY_EQ_INT(0, t[MEM_HOST_FIRST + 4].size, "unregistered table size");
+    }
+
+    iovm1_host_free(&h);
+    return 0;
+}
+
+static uint64_t refstats_get(const uint8_t *d, int n) {
+    uint64_t v = 0;
+    for (int i = n - 1; i >= 0; i--) {
+        v = (v << 8) | d[i];
+    }
+    return v;
+}
+
+int test_refhost_stats(struct iovm1_t *vm) {
+    static struct iovm1_host_t h;
+    static struct iovm1_host_game_t g;
+    const uint8_t *d = refhost_reply_last;
+    int polls = 0;
+    uint8_t b;
+    int r;
+
+    r = iovm1_host_init(&h, 0, 0);
+    VERIFY_EQ_INT(0, r, "iovm1_host_init() return value");
+    h.reply = refhost_reply;
+    r = iovm1_host_enable_stats(&h, IOVM1_HOST_STATS_CHIP);
+    VERIFY_EQ_INT(0, r, "iovm1_host_enable_stats() return value");
+    h.stats.queue_depth = 3;
+    h.stats.cache_hits = 0x100000002ULL;
+
+    // single bytes read like any other chip and the chip is read-only:
+    r = iovm1_host_try_read_byte(&h, IOVM1_HOST_STATS_CHIP, IOVM1_HOST_STAT_QUEUE_DEPTH, &b);
+    VERIFY_EQ_INT(IOVM1_SUCCESS, r, "queue depth read");
+    VERIFY_EQ_INT(3, b, "queue depth");
+    r = iovm1_host_try_write_byte(&h, IOVM1_HOST_STATS_CHIP, IOVM1_HOST_STAT_QUEUE_DEPTH, 0);
+    VERIFY_EQ_INT(IOVM1_ERROR_MEMORY_CHIP_NOT_WRITABLE, r, "stats write");
+
+    // WAIT_UNTIL on the live frame number:
+    iovm1_host_game_init(&g, &h, 1000, 0x1A);
+    iovm1_init(vm);
+    vm->wa.os = IOVM1_OPSTATE_INIT;
+    vm->wa.c = IOVM1_HOST_STATS_CHIP;
+    vm->wa.a = IOVM1_HOST_STAT_FRAME;
+    vm->wa.v = 3;
+    vm->wa.k = 0xFF;
+    vm->wa.q = IOVM1_CMP_NLT;
+
+    r = iovm1_host_game_start(&g);
+    VERIFY_EQ_INT(0, r, "iovm1_host_game_start() return value");
+    do {
+        r = iovm1_host_wait_state_machine(&h, vm);
+        if (r != IOVM1_SUCCESS) {
+            break;
+        }
+        usleep(100);
+    } while (vm->wa.os != IOVM1_OPSTATE_COMPLETED && ++polls < 20000);
+    iovm1_host_game_stop(&g);
+    VERIFY_EQ_INT(IOVM1_OPSTATE_COMPLETED, vm->wa.os, "wait opstate");
+
+    // one READ returns every counter:
+    vm->rd.os = IOVM1_OPSTATE_INIT;
+    vm->rd.c = IOVM1_HOST_STATS_CHIP;
+    vm->rd.a = 0;
+    vm->rd.l = IOVM1_HOST_STATS_SIZE;
+    r = iovm1_host_read_state_machine(&h, vm);
+    VERIFY_EQ_INT(IOVM1_OPSTATE_COMPLETED, vm->rd.os, "read opstate");
+    VERIFY_EQ_INT(h.frame, (uint32_t)refstats_get(d + IOVM1_HOST_STAT_FRAME, 4), "frame");
+    VERIFY_EQ_INT(1, refstats_get(d + IOVM1_HOST_STAT_FRAME_TIME_US, 4) != 0, "frame time");
+    VERIFY_EQ_INT(1, refstats_get(d + IOVM1_HOST_STAT_VBLANK_US, 8) == g.vblank_ns / 1000, "vblank time");
+    VERIFY_EQ_INT(
+        1,
+        refstats_get(d + IOVM1_HOST_STAT_NOW_US, 8) >= refstats_get(d + IOVM1_HOST_STAT_VBLANK_US, 8),
+        "current time"
+    );
+    VERIFY_EQ_INT(3, (uint32_t)refstats_get(d + IOVM1_HOST_STAT_QUEUE_DEPTH, 4), "queue depth");
+    VERIFY_EQ_INT(1, refstats_get(d + IOVM1_HOST_STAT_CACHE_HITS, 8) == 0x100000002ULL, "cache hits");
+
+    iovm1_host_free(&h);
+    return 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 // main runner:
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -245,6 +2234,31 @@ int run_test_suite(void) {
     run_test(test_end)
     run_test(test_reset_from_end)
     run_test(test_reset_retry)
+    run_test(test_rmw)
+    run_test(test_cas)
+    run_test(test_write_verify)
+    run_test(test_compare)
+    run_test(test_search)
+    run_test(test_cmp_operators)
+    run_test(test_abort_unless_in_range)
+    run_test(test_skip_unless)
+    run_test(test_verify)
+    run_test(test_chip_table)
+    run_test(test_acl)
+    run_test(test_checkpoint)
+    run_test(test_summary)
+    run_test(test_hooks)
+    run_test(test_trace)
+    run_test(test_chrome)
+    run_test(test_hist)
+    run_test(test_metrics)
+    run_test(test_refhost)
+    run_test(test_refhost_game)
+    run_test(test_refhost_seqlock)
+    run_test(test_refhost_map)
+    run_test(test_refhost_mapping)
+    run_test(test_refhost_registry)
+    run_test(test_refhost_stats)
 
     return 0;
 }
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../iovm.h"
+#include "../iovm_prof.h"
+#include "../iovm_trace.h"
+#include "../iovm_chrome.h"
+
+// decodes an iovm1 binary trace file to text, one line per record, or with -c to Chrome JSON trace format
+
+static const char *hook_names[] = {
+    [IOVM1_HOOK_INST_START] = "inst_start",
+    [IOVM1_HOOK_INST_END] = "inst_end",
+    [IOVM1_HOOK_STATE] = "state",
+    [IOVM1_HOOK_HOST_ENTER] = "host_enter",
+    [IOVM1_HOOK_HOST_EXIT] = "host_exit",
+    [IOVM1_HOOK_ERROR] = "error",
+};
+
+int main(int argc, char **argv) {
+    struct iovm1_trace_rec_t r;
+    FILE *f;
+    uint64_t t0 = 0;
+    uint64_t n = 0;
+    static struct iovm1_chrome_t chrome;
+    int json = 0;
+    const char *path;
+
+    if (argc == 3 && strcmp(argv[1], "-c") == 0) {
+        json = 1;
+        path = argv[2];
+    } else if (argc == 2) {
+        path = argv[1];
+    } else {
+        fprintf(stderr, "usage: %s [-c] <trace file>\n", argv[0]);
+        return 2;
+    }
+
+    if (!(f = fopen(path, "rb"))) {
+        perror(path);
+        return 1;
+    }
+    if (iovm1_trace_read_header(f) != 0) {
+        fprintf(stderr, "%s: not an iovm1 trace file\n", path);
+        return 1;
+    }
+
+    if (json) {
+        iovm1_chrome_begin(&chrome, stdout);
+        while (fread(&r, sizeof(r), 1, f) == 1) {
+            iovm1_chrome_record(&chrome, &r);
+            n++;
+        }
+        iovm1_chrome_end(&chrome);
+
+        fprintf(stderr, "%llu records\n", (unsigned long long)n);
+        fclose(f);
+        return 0;
+    }
+
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        if (n++ == 0) {
+            t0 = r.t;
+        }
+
+        fprintf(stdout, "%12.3f us  vm %-5u p %06x  %-10s",
+            (double)(r.t - t0) / 1e3, r.vm, r.p,
+            r.h < sizeof(hook_names) / sizeof(hook_names[0]) ? hook_names[r.h] : "?");
+
+        switch (r.h) {
+            case IOVM1_HOOK_INST_START:
+                fprintf(stdout, "  %-12s chip %3u addr %06x len %3u",
+                    iovm1_opcode_name((enum iovm1_opcode)r.arg), r.c, r.a, r.l ? r.l : 256);
+                break;
+            case IOVM1_HOOK_INST_END:
+                fprintf(stdout, "  %-12s e %u", iovm1_opcode_name((enum iovm1_opcode)r.arg), r.e);
+                break;
+            case IOVM1_HOOK_STATE:
+                fprintf(stdout, "  %u -> %u", r.arg, r.s);
+                break;
+            case IOVM1_HOOK_HOST_ENTER:
+                fprintf(stdout, "  host %u", r.arg);
+                break;
+            case IOVM1_HOOK_HOST_EXIT:
+                fprintf(stdout, "  host %u e %u", r.arg, r.e);
+                break;
+            case IOVM1_HOOK_ERROR:
+                fprintf(stdout, "  e %u", r.arg);
+                break;
+        }
+        fprintf(stdout, "\n");
+    }
+
+    fprintf(stderr, "%llu records\n", (unsigned long long)n);
+    fclose(f);
+    return 0;
+}